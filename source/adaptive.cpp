@@ -0,0 +1,110 @@
+#include <math.h>
+#include <algorithm>
+
+#include "adaptive.h"
+
+
+/**
+ * Calculates the limits of every node of the contour p.
+ *
+ * A run starting at node a ends at the last node e for which a line
+ * through p[a] exists that passes within 2*l_max_distance of p[a+1]..p[e].
+ * The cone of these lines is kept as an interval of directions modulo pi
+ * and may only be too wide, which keeps the limits safe.
+ * If an edge (i,j) with i < a < e < j existed, its line would pass within
+ * l_max_distance of all these points and a parallel line through p[a]
+ * within 2*l_max_distance, so the run would not end at e. Hence an edge
+ * ending in a node of the run after the run of a starts at a or later.
+ *
+ * @param par  parameters
+ * @param p    contour points
+ */
+void search_limits::calculate(const parameter& par, const path_view& p)
+{
+    int n = p.size();
+    double w = 2*par.l_max_distance + 1e-9;
+
+    depth.assign(n, par.sp_depth_limit);
+    missed.assign(n, par.sp_missed_limit);
+    runs = 0;
+
+    if (n < 2)
+        return;
+
+    int prev = 0;           // start of the previous run
+    int a = 0;              // start of the current run
+    bool open = false;      // cone initialized
+    double ref = 0;         // direction of the first constraint
+    double lo = 0, hi = 0;  // cone of the possible directions, relative to ref
+
+    for (int k=1; k<=n; k++)
+    {
+        bool end = k==n;
+
+        if (!end)
+        {
+            point d = p[k] - p[a];
+            double r = d.len();
+
+            if (r > w)
+            {
+                double t = atan2(d.y, d.x);
+                double h = asin(w/r);
+
+                if (!open)
+                {
+                    ref = t;
+                    lo = -h;
+                    hi = h;
+                    open = true;
+                }
+                else
+                {
+                    // directions of lines (modulo pi): hull of the
+                    // intersections with the nearest representatives
+                    double c = (lo+hi)/2;
+                    double u = c + remainder(t-ref-c, M_PI);
+                    double l = 1e9, r = -1e9;
+
+                    for (int s=-1; s<=1; s++)
+                    {
+                        double l1 = max(lo, u+s*M_PI-h);
+                        double r1 = min(hi, u+s*M_PI+h);
+                        if (l1 <= r1)
+                        {
+                            l = min(l, l1);
+                            r = max(r, r1);
+                        }
+                    }
+
+                    lo = l;
+                    hi = r;
+                    end = lo > hi;
+                }
+            }
+        }
+
+        if (end)
+        {
+            // the run contains the nodes a+1..k-1
+            int e = k-1;
+            int m = max(2, (e-a)/2);
+
+            for (int j=a+1; j<=e; j++)
+            {
+                depth[j] = min(par.sp_depth_limit, j-prev);
+                if (par.sp_adaptive >= 2)
+                    missed[j] = min(par.sp_missed_limit, m);
+            }
+
+            runs++;
+            prev = a;
+            a = e;
+            open = false;
+
+            // the cone of the new run starts at node k
+            if (k < n)
+                k--;
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef _ADAPTIVE_H_
+#define _ADAPTIVE_H_
+
+#include "parameter.h"
+#include "path.h"
+
+
+/**
+ * Search limits of phase 1 per node of a contour (sp_adaptive).
+ *
+ * The contour is split greedily into straight runs: a run is extended as
+ * long as a line through its first point passes within 2*l_max_distance
+ * of all its points (cone intersection, one pass). A segment ending in
+ * node j cannot start before the run preceding the run of j, so
+ * depth[j] reaches back to the start of that run. This does not change
+ * the result. With sp_adaptive=2 the missed limit also follows the corner
+ * density. In short runs (noise, small specks), a few successive missing
+ * edges already end the scan, which may lose edges.
+ *
+ * Both limits never exceed sp_depth_limit and sp_missed_limit.
+ */
+class search_limits
+{
+public:
+    vector<int> depth;      // sp_depth_limit of node j
+    vector<int> missed;     // sp_missed_limit of node j
+    int runs;               // number of straight runs
+
+    search_limits() : runs(0) {}
+
+    void calculate(const parameter& par, const path_view& p);
+};
+
+#endif
@@ -4,10 +4,10 @@
 
 
 // is the distance between p and the line (p1,p2) less than max_dist?
-static bool check_distance(point p1, point p2, point p, double max_dist)
+static inline bool check_distance(vertex p1, vertex p2, vertex p, double max_dist)
 {
     // (p1,p2) rotated counterclockwise by 90 degree
-    point n = perp(p2-p1);
+    vertex n = perp(p2-p1);
 
     // r = dist(p,(p1,p2))*len(n) */
     double r = dot(n, p-p1);
@@ -28,11 +28,11 @@ static bool check_distance(point p1, point p2, point p, double max_dist)
  *
  * @return true=OK (output in s), false=no intersection point
  */
-static bool cut(point p1, point p2, point p3, point p4, point& s)
+static inline bool cut(vertex p1, vertex p2, vertex p3, vertex p4, vertex& s)
 {
-    point p21 = p2 - p1;
-    point p43 = p4 - p3;
-    point p31 = p3 - p1;
+    vertex p21 = p2 - p1;
+    vertex p43 = p4 - p3;
+    vertex p31 = p3 - p1;
 
     double det = p21.y*p43.x - p21.x*p43.y;
     if (det==0)
@@ -90,6 +90,9 @@ static bool cut(point p1, point p2, point p3, point p4, point& s)
  * path is checked against a limit.
  *
  *
+ * p and q are pointers into arrays or path_view iterators. The points are
+ * converted to double, the calculation is the same with float coordinates.
+ *
  * @param p          first polyline with points p[0]..p[p_cnt-1]
  * @param p_cnt      number of points of p
  * @param q          second polyline with points q[0]..q[q_cnt-1]
@@ -102,9 +105,10 @@ static bool cut(point p1, point p2, point p3, point p4, point& s)
  *                   max_dist (the area between the polylines is returned in area)
  * @retval false     otherwise
  */
-bool calc_area(const node* p, int p_cnt, const point* q, int q_cnt, double max_dist, double& area)
+template<class P, class Q>
+static bool calc_area(P p, int p_cnt, Q q, int q_cnt, double max_dist, double& area)
 {
-    point lp, lq;   // p[-1], q[-1]
+    vertex lp, lq;  // p[-1], q[-1]
     double x;       // start point (x coordinate)
     double yp, yq;  // p[-2].y, q[-2].y
     bool  p_behind; // true: p has to be advanced; false: q has to be advanced
@@ -120,23 +124,23 @@ bool calc_area(const node* p, int p_cnt, const point* q, int q_cnt, double max_d
     if (p_cnt<=0 || q_cnt<=0)
         return false;
     
-    assert(p[0]==q[0]);
-    assert(p[p_cnt]==q[q_cnt]);
+    assert(vertex(p[0])==vertex(q[0]));
+    assert(vertex(p[p_cnt])==vertex(q[q_cnt]));
 
     x = p->x;
-    lp = *p++; --p_cnt;
-    lq = *q++; --q_cnt;
+    lp = vertex(*p++); --p_cnt;
+    lq = vertex(*q++); --q_cnt;
 
     // lp==lq !
 
     // p '<' q ?
-    p_behind = dot(*q-*p, *p-lp) > 0;
+    p_behind = dot(vertex(*q)-vertex(*p), vertex(*p)-lp) > 0;
 
     while (p_cnt>0 || q_cnt>0)
     {
         // points are available in at least one path
 
-        point s;    // intersection point
+        vertex s;   // intersection point
 
         // which pointer has to be advanced
         // special cases: p_cnt==0 --> advance_p==false
@@ -148,38 +152,38 @@ bool calc_area(const node* p, int p_cnt, const point* q, int q_cnt, double max_d
         if (advance_p)
         {
             // p '<' q --> check and advance p
-            if (check_distance(lq, *q, *p, max_dist)==false)
+            if (check_distance(lq, vertex(*q), vertex(*p), max_dist)==false)
                 return false;
 
             yp = lp.y;
-            lp = *p++; --p_cnt;
+            lp = vertex(*p++); --p_cnt;
 
             // p '<' q ?
             //p_behind = dot(*p-*q, *q-lq) < 0;
             
             // determine which pointer to advance in the next round
             if (p_cnt>0)
-                p_behind = dot(*p-*q, p[1]-lp) < 0;
+                p_behind = dot(vertex(*p)-vertex(*q), vertex(p[1])-lp) < 0;
         }
         else
         {
             // q '<' p --> check and advance q
-            if (check_distance(lp, *p, *q, max_dist)==false)
+            if (check_distance(lp, vertex(*p), vertex(*q), max_dist)==false)
                 return false;
 
             yq = lq.y;
-            lq = *q++; --q_cnt;
+            lq = vertex(*q++); --q_cnt;
 
             // p '<' q ?
             //p_behind = dot(*q-*p, *p-lp) > 0;
 
             // determine which pointer to advance in the next round
             if (p_cnt>0)
-                p_behind = dot(*q-*p, p[1]-lp) > 0;
+                p_behind = dot(vertex(*q)-vertex(*p), vertex(p[1])-lp) > 0;
         }
 
         // check for intersection
-        if ( cut(lp, *p, lq, *q, s) )
+        if ( cut(lp, vertex(*p), lq, vertex(*q), s) )
         {
             // calculate area of subpolygon
             if (advance_p)
@@ -216,3 +220,27 @@ bool calc_area(const node* p, int p_cnt, const point* q, int q_cnt, double max_d
     
     return true;
 }
+
+
+bool calc_area(const node* p, int p_cnt, const vertex* q, int q_cnt, double max_dist, double& area)
+{
+    return calc_area<const node*, const vertex*>(p, p_cnt, q, q_cnt, max_dist, area);
+}
+
+
+// calc_area() of two polylines with coordinates of type T
+template<class T>
+bool calc_area(const point_t<T>* p, int p_cnt, const point_t<T>* q, int q_cnt, double max_dist, double& area)
+{
+    return calc_area<const point_t<T>*, const point_t<T>*>(p, p_cnt, q, q_cnt, max_dist, area);
+}
+
+template bool calc_area(const point_t<float>* p, int p_cnt, const point_t<float>* q, int q_cnt, double max_dist, double& area);
+template bool calc_area(const point_t<double>* p, int p_cnt, const point_t<double>* q, int q_cnt, double max_dist, double& area);
+
+
+// calc_area() of two paths, e.g. views of shortest paths
+bool calc_area(const path_view& p, const path_view& q, double max_dist, double& area)
+{
+    return calc_area(p.begin(), p.size(), q.begin(), q.size(), max_dist, area);
+}
@@ -3,9 +3,15 @@
 
 #include "point.h"
 #include "node.h"
+#include "path.h"
 
 
 // area.cpp
-bool calc_area(const node* p, int p_cnt, const point* b, int b_cnt, double max_dist, double& area);
+bool calc_area(const node* p, int p_cnt, const vertex* b, int b_cnt, double max_dist, double& area);
+bool calc_area(const path_view& p, const path_view& q, double max_dist, double& area);
+
+// instantiated for float and double
+template<class T>
+bool calc_area(const point_t<T>* p, int p_cnt, const point_t<T>* q, int q_cnt, double max_dist, double& area);
 
 #endif
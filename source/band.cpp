@@ -0,0 +1,177 @@
+#include <assert.h>
+
+#include "band.h"
+#include "tracer.h"
+#include "timer.h"
+#include "timeline.h"
+
+
+// collect the vertical contour edges (x,y)-(x,y+1), x=0..width, which are
+// traced in direction dy (1=down, -1=up) in ascending order of x
+static void find_edges(const bitmap& map, int y, int dy, vector<int>& edges)
+{
+    int  w = map.get_width();
+    int  x = 0;
+    bool set = false;
+
+    edges.clear();
+
+    for (;;)
+    {
+        x = set ? map.next_bit_clr(x, y) : map.next_bit_set(x, y);
+        if (x >= w)
+            break;
+        set = !set;
+
+        // set pixels are on the right hand side of the direction of tracing
+        if (set == (dy < 0))
+            edges.push_back(x);
+    }
+
+    if (set && dy > 0)
+        edges.push_back(w);
+}
+
+
+void band::trace_piece(piece& c, int id, bool closed)
+{
+    int w = map.get_width();
+    int h = map.get_height();
+    int x = c.sx;
+    int y = c.sy;
+    int last = c.last;
+
+    c.first = chain.size();
+    c.open = !closed;
+    c.fy = -1;
+    c.left = -1;
+    c.hole = false;
+    c.inner = false;
+
+    for (;;)
+    {
+        int index = tracer::direction(map, x, y, last);
+
+        if (tracer::dy[index] > 0)
+            edges.mark(x, y, id);
+        else if (tracer::dy[index] < 0)
+            edges.mark(x, y-1, id);
+        if (tracer::dy[index]!=0 && x>0 && x<w)
+            c.inner = true;
+
+        chain.push_back(index);
+
+        x += tracer::dx[index];
+        y += tracer::dy[index];
+        last = index;
+
+        bool outside = y < y0 || (y >= y1 && y1 < h);
+
+        if (closed)
+        {
+            assert(!outside);
+            if (x==c.sx && y==c.sy)
+                break;
+        }
+        else if (outside)
+            break;
+    }
+
+    c.ex = x;
+    c.ey = y;
+    c.count = chain.size() - c.first;
+}
+
+
+void band::trace()
+{
+    double c0 = time_ms();
+    int h = map.get_height();
+
+    edges.init(y0, y1, map.get_width());
+    pieces.clear();
+    chain.clear();
+
+    vector<int> entry;
+
+    // contours entering from the band above
+    if (y0 > 0)
+        find_edges(map, y0-1, 1, entry);
+
+    for (int i=0; i<(int)entry.size(); i++)
+    {
+        piece c;
+        c.sx = entry[i];
+        c.sy = y0;
+        c.last = 2;             // down
+        trace_piece(c, pieces.size(), false);
+        pieces.push_back(c);
+    }
+
+    above = pieces.size();
+
+    // contours entering from the band below
+    entry.clear();
+    if (y1 < h)
+        find_edges(map, y1-1, -1, entry);
+
+    for (int i=0; i<(int)entry.size(); i++)
+    {
+        piece c;
+        c.sx = entry[i];
+        c.sy = y1-1;
+        c.last = 4;             // up
+        edges.mark(c.sx, y1-1, pieces.size());
+        trace_piece(c, pieces.size(), false);
+        pieces.push_back(c);
+    }
+
+    open = pieces.size();
+
+    // scan the rows like tracer::get_next_contour()
+    for (int y=y0; y<y1; y++)
+    {
+        int  x = 0;
+        bool color = false;     // left of the image is background
+        int  left = -1;
+
+        edges.start_row(y);
+
+        for (;;)
+        {
+            x = color ? map.next_bit_clr(x, y) : map.next_bit_set(x, y);
+            if (x >= map.get_width())
+                break;
+            color = !color;
+
+            int id = edges.owner(x);
+            if (id < 0)
+            {
+                // closed contour inside the band
+                piece c;
+                c.sx = x;
+                c.sy = y;
+                c.last = 8;     // see tracer::trace_points()
+                id = pieces.size();
+                trace_piece(c, id, true);
+                pieces.push_back(c);
+
+                int ret = edges.owner(x);
+                assert(ret == id);
+            }
+
+            piece& c = pieces[id];
+            if (c.fy < 0)
+            {
+                c.fx = x;
+                c.fy = y;
+                c.left = left;
+                c.hole = !color;
+            }
+
+            left = id;
+        }
+    }
+
+    timeline::record("band", c0, time_ms(), "rows", y1-y0);
+}
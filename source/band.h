@@ -0,0 +1,55 @@
+#ifndef _BAND_H_
+#define _BAND_H_
+
+#include "bitmap.h"
+#include "edges.h"
+
+
+// a contour or the piece of a contour inside a band
+class piece
+{
+public:
+    int  sx, sy;            // start point
+    int  ex, ey;            // end point, outside of the band if open
+    int  last;              // direction of the step entering (sx,sy)
+    int  first;             // index of the first step in band::chain
+    int  count;             // number of steps
+    bool open;              // enters and leaves the band
+    int  fx, fy;            // first edge passed by the row scan, fy<0 = none
+    int  left;              // piece of the edge passed before (fx,fy), -1 = none
+    bool hole;              // kind of the contour, if (fx,fy) is its first edge
+    bool inner;             // has a vertical edge off the left and right border
+};
+
+
+/**
+ * Traces the contours in the rows y0..y1-1 of a bitmap independently
+ * of the other bands (see tracer::trace_bands()).
+ *
+ * Contours crossing the upper or lower border of the band are traced
+ * from every point where they enter the band to the point where they
+ * leave it. Then the rows are scanned like in tracer::get_next_contour()
+ * and the remaining (closed) contours are traced.
+ */
+class band
+{
+private:
+    const bitmap& map;
+    edge_rows edges;
+
+    void trace_piece(piece& c, int id, bool closed);
+
+public:
+    int y0, y1;             // rows of the band
+    vector<piece> pieces;   // open pieces entering from above, open pieces
+                            // entering from below, then the closed pieces
+    int above;              // number of pieces entering from above
+    int open;               // number of open pieces
+    vector<char> chain;     // steps of all pieces (direction index)
+
+    band(const bitmap& map, int y0, int y1) : map(map), y0(y0), y1(y1) {}
+
+    void trace();
+};
+
+#endif
@@ -0,0 +1,208 @@
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include <filesystem>
+
+#include "batch.h"
+#include "pipeline.h"
+#include "cache.h"
+#include "timer.h"
+
+
+// get the next PNG file from the source
+bool batch::next_file(string& filename)
+{
+    if (list == NULL)
+    {
+        if (next >= (int)files.size())
+            return false;
+        filename = files[next++];
+        return true;
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), list) != NULL)
+    {
+        // strip line end and skip empty lines and comments
+        int len = strlen(line);
+        while (len>0 && (line[len-1]=='\n' || line[len-1]=='\r'))
+            line[--len] = 0;
+        if (len==0 || line[0]=='#')
+            continue;
+
+        filename = line;
+        return true;
+    }
+
+    return false;
+}
+
+
+// name of the SVG file for a PNG file: the extension is replaced
+string batch::svg_name(const string& filename) const
+{
+    string name = filename;
+
+    if (outdir != NULL)
+        name = string(outdir) + "/" + filesystem::path(filename).filename().string();
+
+    size_t dot = name.find_last_of("./\\");
+    if (dot != string::npos && name[dot]=='.')
+        name.erase(dot);
+
+    return name + ".svg";
+}
+
+
+// worker thread: vectorize images until the source is exhausted
+void batch::work()
+{
+    string filename;
+
+    for (;;)
+    {
+        string filename_svg;
+        bool taken;         // the SVG file of an earlier image has the same name
+        {
+            lock_guard<mutex> guard(lock);
+            if (!next_file(filename))
+                return;
+            filename_svg = svg_name(filename);
+            taken = !names.insert(filename_svg).second;
+        }
+
+        statistics st;
+        int ret = -5;
+        if (!taken)
+            ret = vectorize(par, filename.c_str(), filename_svg.c_str(), st, dc, frames);
+
+        lock_guard<mutex> guard(lock);
+
+        if (taken)
+            fprintf(stderr, "%s: %s is already written for another image\n",
+                filename.c_str(), filename_svg.c_str());
+
+        done++;
+        if (ret != 0)
+            failed++;
+        if (st.cached)
+            cached++;
+
+        printf("{\"file\":");
+        write_json_string(stdout, filename.c_str());
+        printf(",\"status\":%d", ret);
+        if (ret == 0)
+            printf(",\"points\":%d", st.points);
+        if (ret == 0 && st.stages >= 1)
+            printf(",\"lines\":%d,\"area1\":%.0f,\"ms1\":%.3f", st.lines, st.area1, st.time1);
+        if (ret == 0 && st.stages >= 3)
+            printf(",\"curves\":%d,\"segments\":%d,\"area2\":%.0f,\"ms2\":%.3f",
+                st.curves, st.segments, st.area2, st.time2);
+        if (ret == 0)
+            printf(",\"ms\":%.3f", st.total);
+        if (ret == 0 && st.cached)
+            printf(",\"cached\":true");
+        if (ret == 0 && par.tr_min_area > 0 && !st.cached)
+            printf(",\"dropped\":%d,\"dropped_points\":%d,\"dropped_saved_ms\":%.3f",
+                st.dropped, st.dropped_points, st.dropped_saved);
+        if (ret == 0 && (frames != NULL || st.anytime) && !st.cached)
+            printf(",\"contours\":%d", st.contours);
+        if (ret == 0 && frames != NULL && !st.cached)
+            printf(",\"reused\":%d,\"changed_cells\":%d,\"cells\":%d",
+                st.reused, frames->changed, frames->cells);
+        if (ret == 0 && st.anytime)
+            printf(",\"refined\":%d", (int)st.refined.size());
+        if (ret == 0 && par.sp_batch > 0 && !st.cached && !st.anytime)
+            printf(",\"batched\":%d,\"batches\":%d", st.batched, st.batches);
+        if (ret == 0 && par.cache_size > 0)
+            printf(",\"cache_hits\":%d,\"cache_lookups\":%d,\"cache_saved_ms\":%.3f",
+                st.cache_hits, st.cache_lookups, st.cache_saved);
+        if (ret == 0 && par.verify && !st.cached)
+        {
+            const fidelity& f = st.check;
+            printf(",\"error_pixels\":%d,\"hausdorff\":%.3f,\"verify_ms\":%.3f,\"worst\":[",
+                f.pixels, f.hausdorff, f.time);
+            for (int i=0; i<(int)f.worst.size(); i++)
+                printf("%s{\"id\":%d,\"pixels\":%d,\"hausdorff\":%.3f}", i ? "," : "",
+                    f.worst[i].id, f.worst[i].pixels, f.worst[i].hausdorff);
+            printf("]");
+        }
+        if (ret == 0 && par.stats)
+        {
+            printf(",\"stats\":");
+            write_stats_json(stdout, st, par.stats);
+        }
+        printf("}\n");
+        fflush(stdout);
+    }
+}
+
+
+/**
+ * Vectorizes all images of a source.
+ *
+ * @param source  list file with one PNG file per line, a directory
+ *                (all *.png files) or "-" (file names on stdin)
+ * @param jobs    number of worker threads, 0 = number of cores
+ *
+ * @return 0=OK, 1=some images failed, -1=can't read source
+ */
+int batch::run(const char* source, int jobs)
+{
+    next = 0;
+    done = 0;
+    failed = 0;
+    cached = 0;
+    files.clear();
+    names.clear();
+
+    error_code ec;
+    if (strcmp(source, "-")==0)
+        list = stdin;
+    else if (filesystem::is_directory(source, ec))
+    {
+        list = NULL;
+        for (filesystem::directory_iterator it(source, ec), end; it!=end; it.increment(ec))
+        {
+            string ext = it->path().extension().string();
+            if (ext==".png" || ext==".PNG")
+                files.push_back(it->path().string());
+        }
+        sort(files.begin(), files.end());
+    }
+    else if ((list = fopen(source, "r")) == NULL)
+    {
+        fprintf(stderr, "can't read %s\n", source);
+        return -1;
+    }
+
+    if (frames != NULL)
+        jobs = 1;
+    if (jobs <= 0)
+        jobs = thread::hardware_concurrency();
+    if (jobs <= 0)
+        jobs = 1;
+
+    double c0 = time_ms();
+
+    vector<thread> workers;
+    for (int i=0; i<jobs; i++)
+        workers.push_back(thread(&batch::work, this));
+    for (int i=0; i<jobs; i++)
+        workers[i].join();
+
+    double seconds = (time_ms() - c0) / 1000;
+
+    if (list != NULL && list != stdin)
+        fclose(list);
+    list = NULL;
+
+    printf("{\"images\":%d,\"failed\":%d,", done, failed);
+    if (dc != NULL)
+        printf("\"cached\":%d,", cached);
+    printf("\"jobs\":%d,\"seconds\":%.3f,\"images_per_second\":%.1f}\n",
+        jobs, seconds, seconds>0 ? done/seconds : 0);
+    fflush(stdout);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <stdio.h>
+#include <string>
+#include <mutex>
+#include <unordered_set>
+
+#include "parameter.h"
+#include "path.h"
+
+class disk_cache;
+class frame_cache;
+
+
+/**
+ * Vectorizes many images in one process with a pool of worker threads,
+ * each of them processing whole images. The PNG files are taken from
+ * a list file, a directory or from stdin. The statistics of every image
+ * are written to stdout as one JSON object per line.
+ *
+ * In sequence mode the images are frames of a sequence, vectorized in
+ * order by one thread. Contours in unchanged regions of a frame take
+ * their results from the previous frame (see frame_cache).
+ */
+class batch
+{
+private:
+    const parameter& par;
+    const char* outdir;     // directory for the SVG files, NULL = next to the PNG file
+    disk_cache* dc;         // results on disk, NULL = off
+    frame_cache* frames;    // sequence mode: results of the previous frame, NULL = off
+
+    // source of file names
+    FILE*  list;            // list file or stdin, NULL = directory
+    vector<string> files;   // PNG files of the directory
+    int    next;
+    unordered_set<string> names;    // SVG files of the images so far
+
+    mutex  lock;            // guards the source, the counters and stdout
+    int    done;
+    int    failed;
+    int    cached;
+
+    bool next_file(string& filename);
+    string svg_name(const string& filename) const;
+    void work();
+
+public:
+    batch(const parameter& par, const char* outdir, disk_cache* dc = NULL, frame_cache* frames = NULL) :
+        par(par), outdir(outdir), dc(dc), frames(frames), list(NULL) {}
+
+    int run(const char* source, int jobs);
+};
+
+#endif
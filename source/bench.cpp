@@ -0,0 +1,335 @@
+/*
+ * Benchmark of the pipeline stages
+ *
+ * spvec_bench [--warmup N] [--reps N] [--perf] FILE.png ... [name=value ...]
+ *
+ * Every image is read into memory once, then vectorized N times after the
+ * warmup runs. The time of every stage (PNG decode, tracing, phase 1,
+ * intermediate points, phase 2, SVG output) is measured with a monotonic
+ * clock. One JSON object per image is written to stdout with the median,
+ * percentiles and extremes of every stage in milliseconds, followed by a
+ * summary line.
+ *
+ * With --perf the hardware counters (cycles, instructions, cache and branch
+ * misses) are read at the end of every timeline event of vectorize(), the
+ * counts since the previous event belong to its stage. The medians are
+ * reported with the IPC and the misses per traced point. Unavailable
+ * counters are reported as null.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spvec.h"
+#include "bitmap.h"
+#include "timer.h"
+#include "perf.h"
+#include "timeline.h"
+
+
+// stages of the pipeline
+enum { STAGE_DECODE, STAGE_TRACE, STAGE_PHASE1, STAGE_MIDDLE, STAGE_PHASE2, STAGE_OUTPUT, STAGE_TOTAL, STAGES };
+
+static const char* stage_name[STAGES] =
+    { "decode", "trace", "phase1", "middle", "phase2", "output", "total" };
+
+
+// discards the SVG output, counts the bytes
+static size_t count(void* ctx, const char* data, size_t len)
+{
+    *(size_t*)ctx += len;
+    return len;
+}
+
+
+static bool read_file(const char* filename, vector<char>& data)
+{
+    FILE* f = fopen(filename, "rb");
+    if (f==NULL)
+        return false;
+
+    char buf[65536];
+    size_t k;
+    while ((k = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf+k);
+    fclose(f);
+
+    return true;
+}
+
+
+// hardware counters of the stages, read by the timeline hook
+class stage_counters
+{
+public:
+    const perf& pc;
+    uint64_t last[PERF_EVENTS];         // at the end of the previous event
+    uint64_t events[STAGES][PERF_EVENTS];
+
+    stage_counters(const perf& pc) : pc(pc)
+    {
+        memset(events, 0, sizeof(events));
+        pc.read(last);
+    }
+
+    // adds the counts since the previous call to stage
+    void add(int stage)
+    {
+        uint64_t e[PERF_EVENTS];
+        pc.read(e);
+        for (int k=0; k<PERF_EVENTS; k++)
+        {
+            events[stage][k] += e[k] - last[k];
+            last[k] = e[k];
+        }
+    }
+};
+
+
+// stage of a timeline event of vectorize(), the rest counts as output
+static int event_stage(const char* name)
+{
+    if (strcmp(name, "tracer")==0 || strcmp(name, "band")==0 || strcmp(name, "trace")==0)
+        return STAGE_TRACE;
+    if (strcmp(name, "phase1")==0)
+        return STAGE_PHASE1;
+    if (strcmp(name, "middle")==0)
+        return STAGE_MIDDLE;
+    if (strcmp(name, "phase2")==0)
+        return STAGE_PHASE2;
+    return STAGE_OUTPUT;
+}
+
+
+// timeline hook of run()
+static void count_event(void* ctx, const char* name, double begin, double end)
+{
+    ((stage_counters*)ctx)->add(event_stage(name));
+}
+
+
+/**
+ * Vectorizes once, returns the time of every stage.
+ *
+ * @param events  hardware counters of every stage (return) or NULL
+ * @param pc      the counters, only with events
+ */
+static int run(const parameter& par, const vector<char>& png, double* times,
+               uint64_t (*events)[PERF_EVENTS], const perf& pc, statistics& st, size_t& bytes)
+{
+    stage_counters sc(pc);
+    if (events!=NULL)
+        timeline::set_hook(count_event, &sc);
+
+    double c0 = time_ms();
+
+    bitmap map;
+    int ret = map.init_from_png_data(&png[0], png.size());
+    if (events!=NULL)
+        sc.add(STAGE_DECODE);
+    if (ret!=0)
+    {
+        timeline::set_hook(NULL, NULL);
+        return ret;
+    }
+
+    double c1 = time_ms();
+
+    bytes = 0;
+    svg s;
+    s.open(count, &bytes);
+    s.write_header(map.get_width(), map.get_height());
+
+    double c2 = time_ms();
+    if (events!=NULL)
+        sc.add(STAGE_OUTPUT);
+    vectorize(par, map, &s, st, NULL, NULL);
+    double c3 = time_ms();
+
+    s.write_end();
+    s.close();
+
+    double c4 = time_ms();
+    if (events!=NULL)
+    {
+        sc.add(STAGE_OUTPUT);
+        timeline::set_hook(NULL, NULL);
+
+        memset(events[STAGE_TOTAL], 0, sizeof(events[STAGE_TOTAL]));
+        for (int i=0; i<STAGE_TOTAL; i++)
+            for (int k=0; k<PERF_EVENTS; k++)
+            {
+                events[i][k] = sc.events[i][k];
+                events[STAGE_TOTAL][k] += sc.events[i][k];
+            }
+    }
+
+    times[STAGE_DECODE] = c1 - c0;
+    times[STAGE_TRACE]  = st.time_trace;
+    times[STAGE_PHASE1] = st.time1;
+    times[STAGE_MIDDLE] = st.time_middle;
+    times[STAGE_PHASE2] = st.time2;
+    times[STAGE_OUTPUT] = st.time_output + (c2-c1) + (c4-c3);
+    times[STAGE_TOTAL]  = c4 - c0;
+
+    return 0;
+}
+
+
+// median of the counts of an event in a stage
+static uint64_t median(vector<uint64_t> v)
+{
+    sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[(v.size()-1)/2];
+}
+
+
+int main(int argc, char** argv)
+{
+    int warmup = 1;
+    int reps = 10;
+    bool use_perf = false;
+    vector<const char*> files;
+    parameter par;
+
+    par.load("spvec.par");
+
+    for (int i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "--warmup")==0 && i+1<argc)
+            warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--reps")==0 && i+1<argc)
+            reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--perf")==0)
+            use_perf = true;
+        else if (strstr(argv[i],".png")!=NULL || strstr(argv[i],".PNG")!=NULL)
+            files.push_back(argv[i]);
+        else if (!par.parse(argv[i]))
+            fprintf(stderr, "can't parse: %s\n", argv[i]);
+    }
+
+    if (files.empty())
+    {
+        fprintf(stderr, "usage: spvec_bench [--warmup N] [--reps N] [--perf] FILE.png ... [name=value ...]\n");
+        return 1;
+    }
+
+    if (reps < 1)
+        reps = 1;
+
+    perf pc;
+    if (use_perf && pc.open() < PERF_EVENTS)
+    {
+        fprintf(stderr, "hardware counters unavailable:");
+        for (int k=0; k<PERF_EVENTS; k++)
+            if (!pc.available(k))
+                fprintf(stderr, " %s", perf::name[k]);
+        fprintf(stderr, "\n");
+    }
+
+    int failed = 0;
+    double sum[STAGES] = { 0 };     // sum of the medians
+    statistics total;               // sum of the results
+
+    for (int f=0; f<(int)files.size(); f++)
+    {
+        vector<char> png;
+        if (!read_file(files[f], png) || png.empty())
+        {
+            printf("{\"file\":\"%s\",\"status\":-1}\n", files[f]);
+            failed++;
+            continue;
+        }
+
+        vector<double> samples[STAGES];
+        vector<uint64_t> counts[STAGES][PERF_EVENTS];
+        statistics st;
+        size_t bytes = 0;
+        int ret = 0;
+
+        for (int r=0; r<warmup+reps && ret==0; r++)
+        {
+            double times[STAGES];
+            uint64_t events[STAGES][PERF_EVENTS];
+            ret = run(par, png, times, use_perf ? events : NULL, pc, st, bytes);
+            if (r >= warmup)
+                for (int i=0; i<STAGES; i++)
+                {
+                    samples[i].push_back(times[i]);
+                    if (use_perf)
+                        for (int k=0; k<PERF_EVENTS; k++)
+                            counts[i][k].push_back(events[i][k]);
+                }
+        }
+
+        printf("{\"file\":\"%s\",\"status\":%d", files[f], ret);
+        if (ret!=0)
+        {
+            printf("}\n");
+            failed++;
+            continue;
+        }
+
+        printf(",\"warmup\":%d,\"reps\":%d,\"points\":%d,\"lines\":%d,\"area1\":%.0f"
+            ",\"curves\":%d,\"segments\":%d,\"area2\":%.0f,\"bytes\":%lu",
+            warmup, reps, st.points, st.lines, st.area1,
+            st.curves, st.segments, st.area2, (unsigned long)bytes);
+
+        total.lines += st.lines;
+        total.area1 += st.area1;
+        total.curves += st.curves;
+        total.segments += st.segments;
+        total.area2 += st.area2;
+
+        for (int i=0; i<STAGES; i++)
+        {
+            vector<double>& v = samples[i];
+            sort(v.begin(), v.end());
+            sum[i] += percentile(v, 50);
+            printf(",\"%s\":{\"median\":%.4f,\"p10\":%.4f,\"p90\":%.4f,\"min\":%.4f,\"max\":%.4f}",
+                stage_name[i], percentile(v, 50), percentile(v, 10), percentile(v, 90), v.front(), v.back());
+        }
+
+        if (use_perf)
+        {
+            printf(",\"perf\":{");
+            for (int i=0; i<STAGES; i++)
+            {
+                uint64_t m[PERF_EVENTS];
+                for (int k=0; k<PERF_EVENTS; k++)
+                    m[k] = median(counts[i][k]);
+
+                printf("%s\"%s\":{", i ? "," : "", stage_name[i]);
+                for (int k=0; k<PERF_EVENTS; k++)
+                    if (pc.available(k))
+                        printf("\"%s\":%llu,", perf::name[k], (unsigned long long)m[k]);
+                    else
+                        printf("\"%s\":null,", perf::name[k]);
+
+                if (pc.available(PERF_CYCLES) && pc.available(PERF_INSTRUCTIONS) && m[PERF_CYCLES])
+                    printf("\"ipc\":%.3f", (double)m[PERF_INSTRUCTIONS]/m[PERF_CYCLES]);
+                else
+                    printf("\"ipc\":null");
+                for (int k=PERF_CACHE_MISSES; k<=PERF_BRANCH_MISSES; k++)
+                    if (pc.available(k) && st.points)
+                        printf(",\"%s_per_point\":%.4f", perf::name[k], (double)m[k]/st.points);
+                    else
+                        printf(",\"%s_per_point\":null", perf::name[k]);
+                printf("}");
+            }
+            printf("}");
+        }
+        printf("}\n");
+        fflush(stdout);
+    }
+
+    // sum of the results and the medians over all images
+    printf("{\"files\":%d,\"failed\":%d,\"lines\":%d,\"area1\":%.0f,\"curves\":%d,\"segments\":%d,\"area2\":%.0f",
+        (int)files.size(), failed, total.lines, total.area1, total.curves, total.segments, total.area2);
+    for (int i=0; i<STAGES; i++)
+        printf(",\"%s\":%.4f", stage_name[i], sum[i]);
+    printf("}\n");
+
+    return failed ? 1 : 0;
+}
@@ -3,22 +3,35 @@
 #include "bezier.h"
 
 
-static double tab[64+1][4];
-
-
-// Calculate Bernstein polynomials of degree 3
+// Bernstein polynomials of degree 3 at t=i/64 in precision T
 // B(i,t) = choose(3,i) * t^i * (1-t)^(3-i)
-static void init_tab()
+template<class T>
+class bernstein
 {
-    for (int i=0; i<=64; i++)
+public:
+    T tab[64+1][4];
+
+    bernstein()
     {
-        double t = (double)i/64;
-        tab[i][0] =     (1-t)*(1-t)*(1-t);
-        tab[i][1] = 3 * t*(1-t)*(1-t);
-        tab[i][2] = 3 * t*t*(1-t);
-        tab[i][3] =     t*t*t;
+        for (int i=0; i<=64; i++)
+        {
+            double t = (double)i/64;
+            tab[i][0] =     (1-t)*(1-t)*(1-t);
+            tab[i][1] = 3 * t*(1-t)*(1-t);
+            tab[i][2] = 3 * t*t*(1-t);
+            tab[i][3] =     t*t*t;
+        }
     }
-}
+};
+
+
+// the tables are calculated before main() starts, so that bezier_points()
+// can be called from several threads
+static const bernstein<double> tab_double;
+static const bernstein<float>  tab_float;
+
+static inline const double* table(double) { return &tab_double.tab[0][0]; }
+static inline const float*  table(float)  { return &tab_float.tab[0][0]; }
 
 
 /**
@@ -27,27 +40,28 @@ static void init_tab()
  *
  * p[t] = sum_{i=0..3} B(i,t/cnt)*b[i]
  */
-void bezier_points(point* b, point* p, int cnt)
+template<class T>
+void bezier_points(const point_t<T>* b, point_t<T>* p, int cnt)
 {
     assert(cnt==1||cnt==2||cnt==4||cnt==8||cnt==16||cnt==32||cnt==64);
 
-    static bool initialized = false;
-    if (initialized == false)
-    {
-        init_tab();
-        initialized = true;
-    }
-
     int d = 4*64/cnt;
-    double* c = (double*)tab;
+    const T* c = table(T());
 
+    // the sums are calculated in double for both precisions
     while (cnt >= 0)
     {
-        *p++ = b[0]*c[0] + b[1]*c[1] + b[2]*c[2] + b[3]*c[3];
+        double x = c[0]*(double)b[0].x + c[1]*(double)b[1].x + c[2]*(double)b[2].x + c[3]*(double)b[3].x;
+        double y = c[0]*(double)b[0].y + c[1]*(double)b[1].y + c[2]*(double)b[2].y + c[3]*(double)b[3].y;
+        *p++ = point_t<T>(x, y);
         c += d;
         cnt--;
     }
 }
 
 
+template void bezier_points(const point_t<float>* b, point_t<float>* p, int cnt);
+template void bezier_points(const point_t<double>* b, point_t<double>* p, int cnt);
+
+
 
@@ -4,6 +4,8 @@
 #include "point.h"
 
 
-void bezier_points(point* b, point* p, int cnt);
+// instantiated for float and double (bezier.cpp)
+template<class T>
+void bezier_points(const point_t<T>* b, point_t<T>* p, int cnt);
 
 #endif
@@ -1,35 +1,113 @@
 #include <stdio.h>      // NULL, FILE
 #include <string.h>     // memset()
+#include <limits.h>     // INT_MAX
+#include <new>          // nothrow
 
 #include "png.h"        // libpng
 
 #include "bitmap.h"
 
 
+/**
+ * Allocates h rows of o bytes (uninitialized). The size is limited, so
+ * that offsets into the rows fit into an int.
+ *
+ * @return true=OK, false=too large or no memory
+ */
+bool bitmap::alloc(int w, int h, size_t o)
+{
+    delete[] data;
+    data = NULL;
+    width = height = offs = 0;
+
+    if (w<0 || h<0 || w>BITMAP_MAX_SIDE || h>BITMAP_MAX_SIDE)
+        return false;
+    if (h>0 && o > (size_t)INT_MAX/h)
+        return false;
+
+    data = new (std::nothrow) unsigned char[h*o];
+    if (data==NULL)
+        return false;
+
+    width = w;
+    height = h;
+    offs = (int)o;
+    return true;
+}
+
+
 /**
  * Initializes and clears the bitmap.
  *
  * @param w  width
  * @param h  height
  *
- * @return true=OK, false=no memory
+ * @return true=OK, false=too large or no memory
  */
 bool bitmap::init(int w, int h)
 {
-    width = w;
-    height = h;
-    offs = ((w+31)&~31)>>3;
+    if (!alloc(w, h, (((size_t)w+31)&~(size_t)31)>>3))
+        return false;
 
-	delete[] data;
-    data = new unsigned char[height*offs];
-    if (data==NULL)
+    memset(data, 0, (size_t)height*offs);
+    return true;
+}
+
+
+
+/**
+ * Initializes the bitmap from packed rows of 1 bit per pixel
+ * (most significant bit first).
+ *
+ * @param bits    the first row
+ * @param w       width
+ * @param h       height
+ * @param stride  bytes from one row to the next
+ *
+ * @return true=OK, false=too large or no memory
+ */
+bool bitmap::init_from_memory(const unsigned char* bits, int w, int h, int stride)
+{
+    if (!init(w, h))
         return false;
 
-    memset(data, 0, height*offs);
+    int n = (w+7)>>3;
+    int tail = w&7;
+
+    for (int i=0; i<h; i++)
+    {
+        unsigned char* row = get_row_pointer(i);
+        memcpy(row, bits + (long)i*stride, n);
+
+        // clear the bits right of the last pixel
+        if (tail)
+            row[n-1] &= 0xFF00>>tail;
+    }
+
     return true;
 }
 
 
+// read callback of libpng for PNG data in memory
+class png_memory
+{
+public:
+    const unsigned char* data;
+    size_t size;
+    size_t pos;
+};
+
+static void read_memory(png_structp png_ptr, png_bytep out, png_size_t len)
+{
+    png_memory* m = (png_memory*)png_get_io_ptr(png_ptr);
+
+    if (len > m->size - m->pos)
+        png_error(png_ptr, "unexpected end of data");
+
+    memcpy(out, m->data + m->pos, len);
+    m->pos += len;
+}
+
 
 /**
  * Initializes the bitmap from a PNG file of 1 bit depth.
@@ -40,24 +118,52 @@ bool bitmap::init(int w, int h)
  */
 int bitmap::init_from_png(const char* filename)
 {
-    png_structp png_ptr;
-    png_infop   info_ptr;
-    FILE*       fp;
+    FILE* fp;
     
     if ((fp = fopen(filename, "rb")) == NULL)
         return -1;
+
+    int ret = read_png(fp, NULL);
+
+    fclose(fp);
+
+    return ret;
+}
+
+
+/**
+ * Initializes the bitmap from PNG data of 1 bit depth in memory.
+ *
+ * @param data  the content of a PNG file
+ * @param size  number of bytes
+ *
+ * @return 0=OK, -2=no memory, -3=PNG error, -4=wrong depth
+ */
+int bitmap::init_from_png_data(const void* data, size_t size)
+{
+    png_memory m;
+    m.data = (const unsigned char*)data;
+    m.size = size;
+    m.pos  = 0;
+
+    return read_png(NULL, &m);
+}
+
+
+// read a PNG image from the file fp or from memory m
+int bitmap::read_png(FILE* fp, void* m)
+{
+    png_structp png_ptr;
+    png_infop   info_ptr;
+    png_bytep* volatile row_pointers = NULL;    // modified after setjmp()
     
     png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (png_ptr == NULL)
-    {
-        fclose(fp);
         return -2;
-    }
     
     info_ptr = png_create_info_struct(png_ptr);
     if (info_ptr == NULL)
     {
-        fclose(fp);
         png_destroy_read_struct(&png_ptr, NULL, NULL);
         return -2;
     }
@@ -65,30 +171,37 @@ int bitmap::init_from_png(const char* filename)
     if (setjmp(png_jmpbuf(png_ptr)))
     {
         png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-        fclose(fp);
+        delete[] row_pointers;
         return -3;
     }
 
-    png_init_io(png_ptr, fp);
+    if (fp != NULL)
+        png_init_io(png_ptr, fp);
+    else
+        png_set_read_fn(png_ptr, m, read_memory);
     
     png_read_info(png_ptr, info_ptr);
     
     if (png_get_bit_depth(png_ptr, info_ptr) != 1)
+    {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
         return -4;
+    }
     
     // initialize bitmap
-    width  = png_get_image_width(png_ptr, info_ptr);
-    height = png_get_image_height(png_ptr, info_ptr);
-    offs   = png_get_rowbytes(png_ptr, info_ptr);
-
-	delete[] data;
-    data = new unsigned char[height*offs];
-    if (data==NULL)
+    if (!alloc(png_get_image_width(png_ptr, info_ptr), png_get_image_height(png_ptr, info_ptr),
+               png_get_rowbytes(png_ptr, info_ptr)))
+    {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
         return -2;
+    }
 
-    png_bytep* row_pointers = new png_bytep[height];
+    row_pointers = new (std::nothrow) png_bytep[height];
     if (row_pointers==NULL)
+    {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
         return -2;
+    }
 
     for (int i=0; i<height; i++)
         row_pointers[i] = (png_bytep)get_row_pointer(i);
@@ -98,18 +211,59 @@ int bitmap::init_from_png(const char* filename)
     png_read_image(png_ptr, row_pointers);
 
     delete[] row_pointers;
+    row_pointers = NULL;
 
     png_read_end(png_ptr, info_ptr);
 
     png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
     
-    fclose(fp);
-    
     return 0;
 }
 
 
 
+/**
+ * Writes the bitmap as PNG file of 1 bit depth (set pixels black).
+ *
+ * @param filename  the PNG-file to be written
+ *
+ * @return true=OK, false=can't write file
+ */
+bool bitmap::save_png(const char* filename) const
+{
+    FILE* fp;
+
+    if (data==NULL || (fp = fopen(filename, "wb")) == NULL)
+        return false;
+
+    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop   info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+
+    if (info_ptr == NULL || setjmp(png_jmpbuf(png_ptr)))
+    {
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        fclose(fp);
+        return false;
+    }
+
+    png_init_io(png_ptr, fp);
+    png_set_IHDR(png_ptr, info_ptr, width, height, 1, PNG_COLOR_TYPE_PALETTE,
+        PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+
+    png_color palette[2] = { { 255, 255, 255 }, { 0, 0, 0 } };
+    png_set_PLTE(png_ptr, info_ptr, palette, 2);
+
+    png_write_info(png_ptr, info_ptr);
+    for (int i=0; i<height; i++)
+        png_write_row(png_ptr, (png_bytep)get_row_pointer(i));
+    png_write_end(png_ptr, info_ptr);
+
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+
+    return fclose(fp)==0;
+}
+
+
 /**
  * Read 2x2 pixel box at (x,y).
  * @return bit(x-1,y-1)*8 + bit(x,y-1)*4 + bit(x-1,y)*2 + bit(x,y)
@@ -1,9 +1,11 @@
 #ifndef _BITMAP_H_
 #define _BITMAP_H_
 
-#include <stdio.h>          // NULL
+#include <stdio.h>          // NULL, FILE
 #include <assert.h>
 
+#define BITMAP_MAX_SIDE (1<<20)     // largest width and height
+
 
 class bitmap
 {
@@ -16,12 +18,18 @@ private:
     bitmap(const bitmap&);
     bitmap& operator=(const bitmap&);
 
+    bool alloc(int w, int h, size_t o);
+    int read_png(FILE* fp, void* m);
+
 public:
     bitmap() : data(NULL), width(0), height(0), offs(0) {}
     ~bitmap() { delete[] data; }
     
     bool init(int w, int h);
+    bool init_from_memory(const unsigned char* bits, int w, int h, int stride);
     int init_from_png(const char* filename);
+    int init_from_png_data(const void* data, size_t size);
+    bool save_png(const char* filename) const;
 
     unsigned char* get_row_pointer(int i) const
     {
@@ -41,6 +49,13 @@ public:
         data[y*offs+(x>>3)] |= 0x80>>(x&7);
     }
 
+    void clr_bit(int x, int y)
+    {
+        assert(x>=0 && x<width);
+        assert(y>=0 && y<height);
+        data[y*offs+(x>>3)] &= ~(0x80>>(x&7));
+    }
+
     bool bit_is_set(int x, int y) const
     {
 	    assert(x>=0 && x<width);
@@ -0,0 +1,295 @@
+#include <string.h>
+
+#include "cache.h"
+
+
+contour_cache::contour_cache(int capacity) : capacity(capacity), lookups(0), hits(0)
+{
+    for (int k=0; k<2; k++)
+        for (int i=0; i<128; i++)
+        {
+            time[k][i] = 0;
+            count[k][i] = 0;
+        }
+}
+
+
+// hash of the point coordinates relative to p[0] (64-bit FNV-1a)
+uint64_t contour_cache::hash(const path& p)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+
+    for (int i=0; i<(int)p.size(); i++)
+    {
+        double xy[2] = { p[i].x-p[0].x, p[i].y-p[0].y };
+        const unsigned char* c = (const unsigned char*)xy;
+        for (int k=0; k<(int)sizeof(xy); k++)
+            h = (h ^ c[k]) * 0x100000001B3ULL;
+    }
+
+    return h;
+}
+
+
+static bool equal(const path& p, const path& q)
+{
+    if (p.size() != q.size())
+        return false;
+
+    for (int i=0; i<(int)p.size(); i++)
+        if (p[i].x!=q[i].x || p[i].y!=q[i].y)
+            return false;
+
+    return true;
+}
+
+
+// true if q translated to its start point equals p (relative to p[0]==0)
+static bool equal_relative(const path& p, const path& q)
+{
+    if (p.size() != q.size())
+        return false;
+
+    for (int i=0; i<(int)p.size(); i++)
+        if (p[i].x!=q[i].x-q[0].x || p[i].y!=q[i].y-q[0].y)
+            return false;
+
+    return true;
+}
+
+
+/**
+ * Looks up the contour p at any position and marks the entry as most
+ * recently used.
+ *
+ * @return the cached result (p relative to its start point) or NULL
+ */
+const fitted* contour_cache::find(const path& p)
+{
+    if (capacity <= 0 || p.empty())
+        return NULL;
+
+    lookups++;
+
+    auto range = index.equal_range(hash(p));
+    for (auto it=range.first; it!=range.second; ++it)
+        if (equal_relative(it->second->p, p))
+        {
+            entries.splice(entries.begin(), entries, it->second);
+            hits++;
+            return &entries.front();
+        }
+
+    return NULL;
+}
+
+
+/**
+ * Inserts the points and phase 1 of the result f, the least recently used
+ * entry is evicted if the cache is full.
+ */
+void contour_cache::insert(const fitted& f)
+{
+    if (capacity <= 0 || f.p.empty())
+        return;
+
+    if ((int)entries.size() >= capacity)
+    {
+        auto range = index.equal_range(entries.back().key);
+        for (auto it=range.first; it!=range.second; ++it)
+            if (it->second == prev(entries.end()))
+            {
+                index.erase(it);
+                break;
+            }
+        entries.pop_back();
+    }
+
+    entries.push_front(fitted());
+    fitted& e = entries.front();
+    e.p = f.p;
+    for (int i=(int)e.p.size()-1; i>=0; i--)
+    {
+        e.p[i].x -= e.p[0].x;
+        e.p[i].y -= e.p[0].y;
+    }
+    e.nodes = f.nodes;
+    e.cost1 = f.cost1;
+    e.cost2 = f.cost2;
+    e.key = hash(e.p);
+
+    index.insert(make_pair(e.key, entries.begin()));
+}
+
+
+// size class: number of points below 64, then log2
+static int size_class(int points)
+{
+    if (points < 64)
+        return points;
+    int c = 64;
+    while (points > 1 && c < 127)
+    {
+        points >>= 1;
+        c++;
+    }
+    return c;
+}
+
+
+// records the time of a contour, calculated (hit = false) or found in the cache
+void contour_cache::record(int points, double ms, bool hit)
+{
+    int c = size_class(points);
+    time[hit][c] += ms;
+    count[hit][c]++;
+}
+
+
+/**
+ * Estimates the time saved by the hits. Every hit is charged with the mean
+ * time of the calculated contours of its size class, not with the time of
+ * the calculation of its entry: a single slow first calculation (cold
+ * caches, allocation) would otherwise be counted once per hit.
+ *
+ * @return time (ms)
+ */
+double contour_cache::saved() const
+{
+    double ms = 0;
+    for (int i=0; i<128; i++)
+        if (count[1][i] > 0 && count[0][i] > 0)
+            ms += count[1][i] * time[0][i]/count[0][i] - time[1][i];
+    return ms;
+}
+
+
+#define CELL_WIDTH  64      // pixels, one 64-bit word
+#define CELL_HEIGHT 16
+
+
+/**
+ * Starts a frame: compares map with the previous bitmap and keeps the
+ * results of the last frame for find().
+ */
+void frame_cache::next_frame(const bitmap& map)
+{
+    int w = map.get_width();
+    int h = map.get_height();
+    bool same_size = w==width && h==height;
+
+    width = w;
+    height = h;
+    bytes = (w+7)/8;
+    cols = (w+CELL_WIDTH-1)/CELL_WIDTH;
+    rows = (h+CELL_HEIGHT-1)/CELL_HEIGHT;
+    cells = cols*rows;
+
+    // changed cells
+    vector<char> cell(cells, !same_size);
+    if (same_size)
+        for (int y=0; y<h; y++)
+        {
+            const unsigned char* a = map.get_row_pointer(y);
+            const unsigned char* b = &bits[y*bytes];
+            char* c = &cell[(y/CELL_HEIGHT)*cols];
+            for (int i=0; i<bytes; i+=8)
+            {
+                int n = bytes-i < 8 ? bytes-i : 8;
+                uint64_t u = 0, v = 0;
+                memcpy(&u, a+i, n);
+                memcpy(&v, b+i, n);
+                if (u != v)
+                    c[i/8] = 1;
+            }
+        }
+
+    changed = 0;
+    dirty.assign((cols+1)*(rows+1), 0);
+    for (int r=0; r<rows; r++)
+        for (int k=0; k<cols; k++)
+        {
+            changed += cell[r*cols+k];
+            dirty[(r+1)*(cols+1)+k+1] = cell[r*cols+k] + dirty[r*(cols+1)+k+1]
+                + dirty[(r+1)*(cols+1)+k] - dirty[r*(cols+1)+k];
+        }
+
+    bits.resize(h*bytes);
+    for (int y=0; y<h; y++)
+        memcpy(&bits[y*bytes], map.get_row_pointer(y), bytes);
+
+    previous.swap(current);
+    current.clear();
+    if (!same_size)
+        previous.clear();
+    frames++;
+}
+
+
+// start point (a multiple of 0.5) as key
+uint64_t frame_cache::key(const point& origin)
+{
+    return (uint64_t)(uint32_t)llround(origin.x*2) << 32 | (uint32_t)llround(origin.y*2);
+}
+
+
+// true if the pixels x0..x1, y0..y1 (clipped) are unchanged
+bool frame_cache::clean(int x0, int y0, int x1, int y1) const
+{
+    x0 = x0 < 0 ? 0 : x0/CELL_WIDTH;
+    y0 = y0 < 0 ? 0 : y0/CELL_HEIGHT;
+    x1 = x1 >= width ? cols-1 : x1/CELL_WIDTH;
+    y1 = y1 >= height ? rows-1 : y1/CELL_HEIGHT;
+
+    return dirty[(y1+1)*(cols+1)+x1+1] - dirty[y0*(cols+1)+x1+1]
+         - dirty[(y1+1)*(cols+1)+x0] + dirty[y0*(cols+1)+x0] == 0;
+}
+
+
+/**
+ * Looks up the contour p in the previous frame, if the pixels around it
+ * are unchanged. A result found is kept for the next frame.
+ *
+ * @return the result or NULL
+ */
+const fitted* frame_cache::find(const path& p)
+{
+    if (previous.empty() || p.empty())
+        return NULL;
+
+    coord x0 = p[0].x, y0 = p[0].y, x1 = p[0].x, y1 = p[0].y;
+    for (int i=1; i<(int)p.size(); i++)
+    {
+        x0 = min(x0, p[i].x);
+        y0 = min(y0, p[i].y);
+        x1 = max(x1, p[i].x);
+        y1 = max(y1, p[i].y);
+    }
+
+    // a point (x,y) lies between the pixels x-1..x and y-1..y
+    if (!clean((int)floor(x0)-2, (int)floor(y0)-2, (int)ceil(x1)+1, (int)ceil(y1)+1))
+        return NULL;
+
+    auto it = previous.find(key(p[0]));
+    if (it == previous.end() || !equal(it->second.p, p))
+        return NULL;
+
+    fitted& f = current[it->first];
+    f.p.swap(it->second.p);
+    f.nodes.swap(it->second.nodes);
+    f.l2.swap(it->second.l2);
+    f.b.swap(it->second.b);
+    f.cost1 = it->second.cost1;
+    f.cost2 = it->second.cost2;
+    previous.erase(it);
+
+    return &f;
+}
+
+
+// keeps the result f of a contour for the next frame
+void frame_cache::insert(const fitted& f)
+{
+    if (!f.p.empty())
+        current[key(f.p[0])] = f;
+}
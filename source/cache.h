@@ -0,0 +1,107 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <stdint.h>
+#include <list>
+#include <unordered_map>
+
+#include "path.h"
+#include "bitmap.h"
+
+
+// result of a contour (see contour_cache and frame_cache)
+class fitted
+{
+public:
+    path   p;               // traced points (contour_cache: relative to p[0])
+    vector<int> nodes;      // phase 1 as indices of p
+    path   l2;              // intermediate points (before phase 2), frame_cache only
+    path   b;               // phase 2, frame_cache only
+    double cost1;
+    double cost2;
+    uint64_t key;           // hash of p (contour_cache)
+};
+
+
+/**
+ * Cache of phase 1 results with LRU eviction (parameter cache_size).
+ *
+ * A shape that occurs several times in an image (glyphs, symbols) is
+ * traced to the same point sequence at another position. The key is a
+ * hash of the sequence relative to its start point, on a match the
+ * points are compared. Phase 1 only uses differences of the points, which
+ * lie on half pixels and are exact in both precisions, so its nodes are
+ * exactly the ones of a recalculation at the new position. The
+ * intermediate points and phase 2 round depending on the absolute
+ * coordinates and are calculated again.
+ */
+class contour_cache
+{
+private:
+    int capacity;           // maximal number of entries, 0 = disabled
+
+    list<fitted> entries;   // most recently used first
+    unordered_multimap<uint64_t, list<fitted>::iterator> index;
+
+    // times of misses and hits by size class (see record())
+    double time[2][128];
+    int    count[2][128];
+
+public:
+    int    lookups;
+    int    hits;
+
+    contour_cache(int capacity);
+
+    bool enabled() const { return capacity > 0; }
+
+    static uint64_t hash(const path& p);
+    const fitted* find(const path& p);
+    void insert(const fitted& f);
+
+    void   record(int points, double ms, bool hit);
+    double saved() const;
+};
+
+
+/**
+ * Results of the previous frame of a sequence (sequence mode).
+ *
+ * next_frame() compares the bitmap with the one of the previous frame word
+ * by word and marks the cells of 64x16 pixels that changed. The traced
+ * points of a contour only depend on the pixels next to it. So a contour
+ * whose bounding box (plus one pixel) lies in unchanged cells is traced
+ * to the same points as in the previous frame, and its result is taken
+ * from there. Results are kept by start point, for one frame.
+ * The points are absolute, so a result found is exactly the one of a
+ * recalculation.
+ */
+class frame_cache
+{
+private:
+    int width, height;          // of the previous bitmap, 0 = none
+    int bytes;                  // per row
+    vector<unsigned char> bits; // previous bitmap
+
+    int cols, rows;             // cells
+    vector<int> dirty;          // summed-area table of the changed cells, (cols+1)*(rows+1)
+
+    unordered_map<uint64_t, fitted> previous;   // by start point
+    unordered_map<uint64_t, fitted> current;
+
+    static uint64_t key(const point& origin);
+    bool clean(int x0, int y0, int x1, int y1) const;
+
+public:
+    int frames;                 // frames so far
+    int changed;                // changed cells of the current frame
+    int cells;                  // all cells of the current frame
+
+    frame_cache() : width(0), height(0), bytes(0), cols(0), rows(0), frames(0), changed(0), cells(0) {}
+
+    void next_frame(const bitmap& map);
+    const fitted* find(const path& p);
+    void insert(const fitted& f);
+};
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Load-test client for spvec --serve
+ *
+ * spvec_client SOCKET FILE.png [-n REQUESTS] [-c CONNECTIONS] [-o FILE.svg] [name=value ...]
+ *
+ * Sends the PNG file REQUESTS times over CONNECTIONS parallel connections
+ * and prints the latency percentiles seen by the client and the server.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+using namespace std;
+
+#include "timer.h"
+
+
+static const char* socket_path;
+static string header_tail;          // parameter overrides
+static vector<char> png;
+static const char* filename_svg = NULL;
+
+static mutex results_lock;   // guards the results
+static vector<double> latency;
+static int failed = 0;
+
+
+static int connect_server()
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path)-1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd>=0 && connect(fd, (sockaddr*)&addr, sizeof(addr))!=0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+
+static bool write_all(int fd, const char* data, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t k = send(fd, data, n, MSG_NOSIGNAL);
+        if (k < 0 && errno==EINTR)
+            continue;
+        if (k <= 0)
+            return false;
+        data += k;
+        n -= k;
+    }
+
+    return true;
+}
+
+
+static bool read_all(int fd, char* data, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t k = read(fd, data, n);
+        if (k < 0 && errno==EINTR)
+            continue;
+        if (k <= 0)
+            return false;
+        data += k;
+        n -= k;
+    }
+
+    return true;
+}
+
+
+// send one request and receive the answer, false = connection lost
+static bool request(int fd, const string& head, const char* data, size_t size, int& status, vector<char>& answer)
+{
+    if (!write_all(fd, head.data(), head.size()) || !write_all(fd, data, size))
+        return false;
+
+    // answer line "STATUS LENGTH"
+    char line[64];
+    int i = 0;
+    while (i < (int)sizeof(line)-1)
+    {
+        if (!read_all(fd, line+i, 1))
+            return false;
+        if (line[i++]=='\n')
+            break;
+    }
+    line[i] = 0;
+
+    int len;
+    if (sscanf(line, "%d %d", &status, &len)!=2 || len<0)
+        return false;
+
+    answer.resize(len);
+    return len==0 || read_all(fd, &answer[0], len);
+}
+
+
+// one connection sending n requests
+static void run(int n)
+{
+    int fd = connect_server();
+    vector<double> times;
+    int errors = 0;
+    vector<char> answer;
+
+    char head[64];
+    snprintf(head, sizeof(head), "png %d", (int)png.size());
+    string h = head + header_tail + "\n";
+
+    for (int i=0; i<n; i++)
+    {
+        int status;
+        double c0 = time_ms();
+        if (fd<0 || !request(fd, h, &png[0], png.size(), status, answer))
+        {
+            errors += n-i;
+            break;
+        }
+        times.push_back(time_ms() - c0);
+        if (status != 0)
+            errors++;
+    }
+
+    if (fd >= 0)
+        close(fd);
+
+    lock_guard<mutex> guard(results_lock);
+    latency.insert(latency.end(), times.begin(), times.end());
+    failed += errors;
+
+    if (filename_svg!=NULL && !answer.empty())
+    {
+        FILE* f = fopen(filename_svg, "w");
+        if (f!=NULL)
+        {
+            fwrite(&answer[0], 1, answer.size(), f);
+            fclose(f);
+        }
+        filename_svg = NULL;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    int requests = 100;
+    int connections = 1;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: spvec_client SOCKET FILE.png [-n REQUESTS] [-c CONNECTIONS] [-o FILE.svg] [name=value ...]\n");
+        return 1;
+    }
+
+    socket_path = argv[1];
+
+    FILE* f = fopen(argv[2], "rb");
+    if (f==NULL)
+    {
+        fprintf(stderr, "can't read %s\n", argv[2]);
+        return 1;
+    }
+    char buf[65536];
+    size_t k;
+    while ((k = fread(buf, 1, sizeof(buf), f)) > 0)
+        png.insert(png.end(), buf, buf+k);
+    fclose(f);
+
+    for (int i=3; i<argc; i++)
+    {
+        if (strcmp(argv[i], "-n")==0 && i+1<argc)
+            requests = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c")==0 && i+1<argc)
+            connections = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-o")==0 && i+1<argc)
+            filename_svg = argv[++i];
+        else
+            header_tail += string(" ") + argv[i];
+    }
+
+    if (connections < 1)
+        connections = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    double c0 = time_ms();
+
+    vector<thread> threads;
+    for (int i=0; i<connections; i++)
+        threads.push_back(thread(run, requests/connections + (i < requests%connections)));
+    for (int i=0; i<connections; i++)
+        threads[i].join();
+
+    double seconds = (time_ms() - c0) / 1000;
+
+    sort(latency.begin(), latency.end());
+    printf("{\"requests\":%d,\"failed\":%d,\"connections\":%d,\"seconds\":%.3f,\"requests_per_second\":%.1f"
+        ",\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}\n",
+        requests, failed, connections, seconds, seconds>0 ? latency.size()/seconds : 0,
+        percentile(latency, 50), percentile(latency, 90), percentile(latency, 99),
+        latency.empty() ? 0 : latency.back());
+
+    // latencies measured by the server
+    int fd = connect_server();
+    int status;
+    vector<char> answer;
+    if (fd>=0 && request(fd, "stats\n", NULL, 0, status, answer))
+        printf("server: %.*s", (int)answer.size(), answer.empty() ? "" : &answer[0]);
+    if (fd >= 0)
+        close(fd);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,87 @@
+#ifndef _COUNTERS_H_
+#define _COUNTERS_H_
+
+#include <stdio.h>
+
+
+/**
+ * Counters of the shortest path calculation of one phase. They are
+ * updated with COUNT() only if the code is compiled with SPVEC_COUNTERS,
+ * otherwise they remain 0 and cost nothing.
+ */
+class counters
+{
+public:
+    long nodes;             // nodes processed
+    long scanned;           // predecessors scanned (average scan depth = scanned/nodes)
+    long cost;              // edges whose cost() fits a line or curve (not the straight
+                            // lines of phase 2 or the edges replayed by the sweep)
+    long feasible;          // edges that exist
+    long infeasible;        // edges that do not exist
+    long missed_breaks;     // scans stopped by sp_missed_limit
+    long depth_breaks;      // scans stopped by sp_depth_limit
+    long calc_area;         // calc_area() calls
+
+    // fit_bezier() (phase 2)
+    long fit_calls;
+    long fit_tangents;      // rejected: start or end tangent points backwards
+    long fit_tried;         // candidate points tried
+    long fit_singular;      // rejected: no solution for the control points
+    long fit_direction;     // rejected: direction of the control points
+    long fit_length;        // rejected: distance of the control points
+    long fit_distance;      // rejected: b_max_distance exceeded
+
+    counters() { clear(); }
+
+    void clear()
+    {
+        nodes = scanned = cost = feasible = infeasible = 0;
+        missed_breaks = depth_breaks = calc_area = 0;
+        fit_calls = fit_tangents = fit_tried = 0;
+        fit_singular = fit_direction = fit_length = fit_distance = 0;
+    }
+
+    void add(const counters& c)
+    {
+        nodes += c.nodes;
+        scanned += c.scanned;
+        cost += c.cost;
+        feasible += c.feasible;
+        infeasible += c.infeasible;
+        missed_breaks += c.missed_breaks;
+        depth_breaks += c.depth_breaks;
+        calc_area += c.calc_area;
+        fit_calls += c.fit_calls;
+        fit_tangents += c.fit_tangents;
+        fit_tried += c.fit_tried;
+        fit_singular += c.fit_singular;
+        fit_direction += c.fit_direction;
+        fit_length += c.fit_length;
+        fit_distance += c.fit_distance;
+    }
+
+    // write as JSON object
+    void write_json(FILE* f) const
+    {
+        fprintf(f, "{\"nodes\":%ld,\"scanned\":%ld,\"scan_depth\":%.2f,\"cost\":%ld"
+            ",\"feasible\":%ld,\"infeasible\":%ld,\"missed_breaks\":%ld,\"depth_breaks\":%ld"
+            ",\"calc_area\":%ld",
+            nodes, scanned, nodes ? (double)scanned/nodes : 0, cost,
+            feasible, infeasible, missed_breaks, depth_breaks, calc_area);
+        if (fit_calls)
+            fprintf(f, ",\"fit_calls\":%ld,\"fit_tangents\":%ld,\"fit_tried\":%ld,\"fit_singular\":%ld"
+                ",\"fit_direction\":%ld,\"fit_length\":%ld,\"fit_distance\":%ld",
+                fit_calls, fit_tangents, fit_tried, fit_singular,
+                fit_direction, fit_length, fit_distance);
+        fprintf(f, "}");
+    }
+};
+
+
+#ifdef SPVEC_COUNTERS
+#define COUNT(c, field)     ((c).field++)
+#else
+#define COUNT(c, field)     ((void)0)
+#endif
+
+#endif
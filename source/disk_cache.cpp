@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+
+#include "disk_cache.h"
+#include "point.h"
+
+
+disk_cache::disk_cache(const char* dir, long long limit) : dir(dir), limit(limit), used(0)
+{
+}
+
+
+// creates the directory and sums the size of the entries
+bool disk_cache::init()
+{
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    if (!filesystem::is_directory(dir, ec))
+        return false;
+
+    used = 0;
+    for (filesystem::directory_iterator it(dir, ec), end; it!=end; it.increment(ec))
+        if (it->path().extension() == ".svgc")
+            used += it->file_size(ec);
+
+    return true;
+}
+
+
+// 64-bit FNV-1a, h continues a previous hash
+uint64_t disk_cache::hash(const void* data, size_t size, uint64_t h)
+{
+    const unsigned char* c = (const unsigned char*)data;
+    for (size_t i=0; i<size; i++)
+        h = (h ^ c[i]) * 0x100000001B3ULL;
+    return h;
+}
+
+
+// key of a PNG file content and the parameters
+uint64_t disk_cache::key(const vector<char>& png, const parameter& par)
+{
+    string text = par.text();
+    uint64_t h = hash(png.data(), png.size());
+    h = hash(text.data(), text.size(), h);
+
+    // a build with float coordinates (make FLOAT=1) has its own entries
+    if (sizeof(coord) != sizeof(double))
+        h = hash("float", 5, h);
+
+    return h;
+}
+
+
+string disk_cache::entry_name(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.svgc", (unsigned long long)key);
+    return dir + name;
+}
+
+
+/**
+ * Reads an entry. A damaged entry or one of another PNG file or other
+ * parameters (hash collision) is removed.
+ *
+ * @return true if found
+ */
+bool disk_cache::find(uint64_t key, size_t png_size, const parameter& par, cached_result& r)
+{
+    string name = entry_name(key);
+    FILE* f = fopen(name.c_str(), "rb");
+    if (f==NULL)
+        return false;
+
+    unsigned long long size1 = 0, size2 = 0, checksum = 0;
+    bool ok =
+        fscanf(f, "spvec-cache 1 %llu %llu %llx\n", &size1, &size2, &checksum)==3 &&
+        fscanf(f, "%d %d %d %d %lf %d %d %lf %d\n", &r.width, &r.height,
+            &r.points, &r.lines, &r.area1, &r.curves, &r.segments, &r.area2, &r.contours)==9 &&
+        size1==png_size;
+
+    // parameters up to the empty line
+    string text;
+    char line[256];
+    while (ok && fgets(line, sizeof(line), f)!=NULL && strcmp(line, "\n")!=0)
+        text += line;
+    ok = ok && text==par.text();
+
+    if (ok)
+    {
+        r.body.resize(size2);
+        ok = fread(&r.body[0], 1, size2, f)==size2 && fgetc(f)==EOF &&
+             hash(r.body.data(), r.body.size())==checksum;
+    }
+    fclose(f);
+
+    error_code ec;
+    if (!ok)
+    {
+        r.body.clear();
+        filesystem::remove(name, ec);
+        return false;
+    }
+
+    // most recently used
+    filesystem::last_write_time(name, filesystem::file_time_type::clock::now(), ec);
+    return true;
+}
+
+
+/**
+ * Writes an entry (temporary file, then renamed) and removes the least
+ * recently used entries if the cache is too large.
+ *
+ * @return true if written
+ */
+bool disk_cache::insert(uint64_t key, size_t png_size, const parameter& par, const cached_result& r)
+{
+    static atomic<int> count(0);
+
+    // would evict everything else
+    if ((long long)r.body.size() > limit/4*3)
+        return false;
+
+    string name = entry_name(key);
+    string temp = name + "." + to_string(getpid()) + "." + to_string(count++) + ".tmp";
+
+    FILE* f = fopen(temp.c_str(), "wb");
+    if (f==NULL)
+        return false;
+
+    fprintf(f, "spvec-cache 1 %llu %llu %016llx\n", (unsigned long long)png_size,
+        (unsigned long long)r.body.size(), (unsigned long long)hash(r.body.data(), r.body.size()));
+    fprintf(f, "%d %d %d %d %.17g %d %d %.17g %d\n", r.width, r.height,
+        r.points, r.lines, r.area1, r.curves, r.segments, r.area2, r.contours);
+    fprintf(f, "%s\n", par.text().c_str());
+    bool ok = fwrite(r.body.data(), 1, r.body.size(), f)==r.body.size();
+    long long size = ftell(f);
+    ok = fclose(f)==0 && ok;
+
+    error_code ec;
+    if (ok)
+        filesystem::rename(temp, name, ec);
+    if (!ok || ec)
+    {
+        filesystem::remove(temp, ec);
+        return false;
+    }
+
+    lock_guard<mutex> guard(lock);
+    used += size;
+    if (used > limit)
+        evict();
+
+    return true;
+}
+
+
+// removes the least recently used entries down to 3/4 of the limit
+void disk_cache::evict()
+{
+    class entry
+    {
+    public:
+        filesystem::path name;
+        filesystem::file_time_type time;
+        long long size;
+    };
+
+    // the directory may be shared, so count again
+    vector<entry> entries;
+    error_code ec;
+    used = 0;
+    for (filesystem::directory_iterator it(dir, ec), end; it!=end; it.increment(ec))
+        if (it->path().extension() == ".svgc")
+        {
+            entry e;
+            e.name = it->path();
+            e.time = it->last_write_time(ec);
+            e.size = it->file_size(ec);
+            if (ec)
+                continue;
+            entries.push_back(e);
+            used += e.size;
+        }
+
+    sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) { return a.time < b.time; });
+
+    for (int i=0; i<(int)entries.size() && used > limit/4*3; i++)
+        if (filesystem::remove(entries[i].name, ec))
+            used -= entries[i].size;
+}
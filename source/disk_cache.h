@@ -0,0 +1,68 @@
+#ifndef _DISK_CACHE_H_
+#define _DISK_CACHE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "parameter.h"
+
+using namespace std;
+
+
+// a vectorized image as stored in the disk cache
+class cached_result
+{
+public:
+    int    width, height;
+    int    points, lines, curves, segments, contours;
+    double area1, area2;
+    string body;            // SVG output between write_image() and write_end()
+};
+
+
+/**
+ * Results of the file modes on disk (option --cache DIR), for images that
+ * are vectorized again: re-exports, retries, re-runs of a pipeline.
+ *
+ * The key is a hash of the PNG file content and of all parameters, so a
+ * hit needs neither decoding nor tracing. Every entry is one file
+ * DIR/KEY.svgc:
+ *
+ *   spvec-cache 1 PNG_SIZE BODY_SIZE CHECKSUM
+ *   width height points lines area1 curves segments area2 contours
+ *   parameters (lines name=value, see parameter::text())
+ *   empty line
+ *   body
+ *
+ * Entries are written to a temporary file and renamed, so readers (also
+ * other processes) never see a partial entry. An entry is only used if the
+ * PNG size, the parameters and the checksum (FNV-1a) of the body match,
+ * otherwise it is removed. A hit updates the modification time; when the
+ * files exceed the size limit the least recently used ones are removed.
+ */
+class disk_cache
+{
+private:
+    string    dir;
+    long long limit;        // maximal size of all entries (bytes)
+    long long used;         // estimated size of all entries (bytes)
+    mutex     lock;         // eviction
+
+    string entry_name(uint64_t key) const;
+    void   evict();
+
+public:
+    disk_cache(const char* dir, long long limit);
+
+    bool init();
+
+    static uint64_t hash(const void* data, size_t size, uint64_t h = 0xCBF29CE484222325ULL);
+    static uint64_t key(const vector<char>& png, const parameter& par);
+
+    bool find(uint64_t key, size_t png_size, const parameter& par, cached_result& r);
+    bool insert(uint64_t key, size_t png_size, const parameter& par, const cached_result& r);
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <assert.h>
+
+#include "edges.h"
+
+
+// prepare for the rows top..bottom-1; scanning starts with start_row(top)
+void edge_rows::init(int top, int bottom, int width)
+{
+    this->top = top;
+    this->width = width;
+    posy = top-1;
+    next = 0;
+
+    rows.clear();
+    rows.resize(bottom-top);
+
+    while (!pending.empty())
+        pending.pop();
+}
+
+
+// start scanning row y
+void edge_rows::start_row(int y)
+{
+    assert(pending.empty());
+
+    // the edges of the previous row are not needed any more
+    if (posy >= top)
+        vector<crossing>().swap(rows[posy-top]);
+
+    posy = y;
+    next = 0;
+
+    if (posy-top < (int)rows.size())
+        sort(rows[posy-top].begin(), rows[posy-top].end());
+}
+
+
+// return the contour of the traced edge at (x,posy) or -1 if not yet traced.
+// Every edge of the row has to be queried once in ascending order of x.
+int edge_rows::owner(int x)
+{
+    vector<crossing>& row = rows[posy-top];
+
+    if (next < (int)row.size() && row[next].x == x)
+        return row[next++].id;
+
+    if (!pending.empty() && pending.top().x == x)
+    {
+        int id = pending.top().id;
+        pending.pop();
+        return id;
+    }
+
+    return -1;
+}
+
+
+// record that the edge (x,y)-(x,y+1) belongs to contour id
+void edge_rows::mark(int x, int y, int id)
+{
+    if (x >= width || y < top || y-top >= (int)rows.size())
+        return;             // outside or on the right border (never scanned)
+
+    if (y > posy)
+        rows[y-top].push_back(crossing(x, id));
+    else if (y == posy)
+        pending.push(crossing(x, id));
+}
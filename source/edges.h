@@ -0,0 +1,46 @@
+#ifndef _EDGES_H_
+#define _EDGES_H_
+
+#include <queue>
+#include <functional>
+
+#include "path.h"
+
+
+/**
+ * The traced vertical contour edges of a range of rows. Each edge is
+ * recorded with the contour it belongs to. The rows are scanned from top
+ * to bottom, the edges of the current row in ascending order of x.
+ */
+class edge_rows
+{
+private:
+    // a traced vertical contour edge from (x,y) to (x,y+1)
+    class crossing
+    {
+    public:
+        int x;
+        int id;             // contour the edge belongs to
+
+        crossing(int x, int id) : x(x), id(id) {}
+
+        bool operator<(const crossing& c) const { return x < c.x; }
+        bool operator>(const crossing& c) const { return x > c.x; }
+    };
+
+    vector< vector<crossing> > rows;    // traced edges of the rows below posy
+    priority_queue<crossing, vector<crossing>, greater<crossing> > pending;
+                                        // traced edges of row posy not yet passed
+    int top;                // first row
+    int width;              // edges with x>=width are not scanned
+    int posy;               // current row
+    int next;               // next edge of rows[posy] not yet passed
+
+public:
+    void init(int top, int bottom, int width);
+    void start_row(int y);
+    int  owner(int x);
+    void mark(int x, int y, int id);
+};
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * Generator of synthetic bi-level images for benchmarks
+ *
+ * spvec_gen FILE.png [--size WxH] [--contours N] [--length L] [--spread S]
+ *                    [--curved F] [--depth D] [--specks N] [--seed N]
+ *
+ * The shapes are placed on a grid, one per cell, so they never touch and
+ * the number of contours is known in advance:
+ *
+ *   --contours  number of shapes (default 100)
+ *   --length    median contour length in pixels (default 200), the lengths
+ *               are log-normally distributed with sigma --spread (default 0.5)
+ *               and limited by the cell size
+ *   --curved    fraction of round shapes: ellipses and glyph-like blobs;
+ *               the others are straight: rectangles and polygons (default 0.5)
+ *   --depth     nesting depth, every shape is drawn as D nested contours
+ *               alternating between filled and hole (default 1)
+ *   --specks    number of noise specks of 1..3 pixels (default 0)
+ *   --seed      seed of the random numbers (default 1)
+ *
+ * The same arguments always produce the same image. A JSON line with the
+ * number of contours drawn is written to stdout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+
+#include "bitmap.h"
+#include "point.h"
+#include "path.h"
+
+
+// deterministic random numbers (splitmix64), independent of the C library
+class generator
+{
+private:
+    uint64_t state;
+
+public:
+    generator(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z>>30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z>>27)) * 0x94D049BB133111EBULL;
+        return z ^ (z>>31);
+    }
+
+    // uniform in [0,1)
+    double uniform()
+    {
+        return (next()>>11) * (1.0/9007199254740992.0);
+    }
+
+    // uniform in [a,b)
+    double uniform(double a, double b)
+    {
+        return a + (b-a)*uniform();
+    }
+
+    // standard normal distribution (Box-Muller)
+    double normal()
+    {
+        double u = 1 - uniform();
+        return sqrt(-2*log(u)) * cos(2*M_PI*uniform());
+    }
+};
+
+
+// fill the polygon (even-odd rule) with set or clear pixels
+static void fill_polygon(bitmap& map, const vector<vertex>& poly, bool set)
+{
+    double y0 = poly[0].y, y1 = poly[0].y;
+    for (int i=1; i<(int)poly.size(); i++)
+    {
+        y0 = min(y0, poly[i].y);
+        y1 = max(y1, poly[i].y);
+    }
+
+    int ya = max(0, (int)floor(y0));
+    int yb = min(map.get_height()-1, (int)ceil(y1));
+    vector<double> xs;
+
+    for (int y=ya; y<=yb; y++)
+    {
+        // crossings of the pixel centers' row
+        double yc = y + 0.5;
+        xs.clear();
+        for (int i=0, j=poly.size()-1; i<(int)poly.size(); j=i++)
+        {
+            const vertex& a = poly[j];
+            const vertex& b = poly[i];
+            if ((a.y <= yc) != (b.y <= yc))
+                xs.push_back(a.x + (yc-a.y)/(b.y-a.y)*(b.x-a.x));
+        }
+        sort(xs.begin(), xs.end());
+
+        for (int k=0; k+1<(int)xs.size(); k+=2)
+        {
+            int xa = max(0, (int)ceil(xs[k]-0.5));
+            int xb = min(map.get_width()-1, (int)ceil(xs[k+1]-0.5)-1);
+            for (int x=xa; x<=xb; x++)
+                if (set)
+                    map.set_bit(x, y);
+                else
+                    map.clr_bit(x, y);
+        }
+    }
+}
+
+
+// outline of a shape with center c and radius r at most
+static void make_shape(generator& rnd, bool curved, vertex c, double r, vector<vertex>& poly)
+{
+    poly.clear();
+    double rot = rnd.uniform(0, 2*M_PI);
+    int kind = rnd.uniform() < 0.5;
+
+    if (!curved && kind==0)
+    {
+        // axis-parallel rectangle
+        double w = r * rnd.uniform(0.5, 1) / sqrt(2.0);
+        double h = r * rnd.uniform(0.5, 1) / sqrt(2.0);
+        poly.push_back(vertex(c.x-w, c.y-h));
+        poly.push_back(vertex(c.x+w, c.y-h));
+        poly.push_back(vertex(c.x+w, c.y+h));
+        poly.push_back(vertex(c.x-w, c.y+h));
+    }
+    else if (!curved)
+    {
+        // rotated polygon with 3..8 corners
+        int n = 3 + (int)rnd.uniform(0, 6);
+        for (int i=0; i<n; i++)
+        {
+            double a = rot + 2*M_PI*(i + rnd.uniform(-0.2, 0.2))/n;
+            double d = r * rnd.uniform(0.7, 1);
+            poly.push_back(vertex(c.x + d*cos(a), c.y + d*sin(a)));
+        }
+    }
+    else
+    {
+        // ellipse or blob r(t) = 1 + a2 cos(2t+p2) + a3 cos(3t+p3)
+        double aspect = kind==0 ? rnd.uniform(0.5, 1) : 1;
+        double a2 = kind==0 ? 0 : rnd.uniform(0, 0.2);
+        double a3 = kind==0 ? 0 : rnd.uniform(0, 0.1);
+        double p2 = rnd.uniform(0, 2*M_PI);
+        double p3 = rnd.uniform(0, 2*M_PI);
+        double scale = r / (1 + a2 + a3);
+
+        int n = max(16, (int)(2*M_PI*r/2));
+        for (int i=0; i<n; i++)
+        {
+            double t = 2*M_PI*i/n;
+            double d = scale * (1 + a2*cos(2*t+p2) + a3*cos(3*t+p3));
+            double x = d*cos(t);
+            double y = d*sin(t)*aspect;
+            poly.push_back(vertex(c.x + x*cos(rot) - y*sin(rot), c.y + x*sin(rot) + y*cos(rot)));
+        }
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* filename = NULL;
+    int    width = 2000, height = 2000;
+    int    shapes = 100;
+    double length = 200;
+    double spread = 0.5;
+    double curved = 0.5;
+    int    depth = 1;
+    int    specks = 0;
+    long   seed = 1;
+
+    for (int i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "--size")==0 && i+1<argc)
+            sscanf(argv[++i], "%dx%d", &width, &height);
+        else if (strcmp(argv[i], "--contours")==0 && i+1<argc)
+            shapes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--length")==0 && i+1<argc)
+            length = atof(argv[++i]);
+        else if (strcmp(argv[i], "--spread")==0 && i+1<argc)
+            spread = atof(argv[++i]);
+        else if (strcmp(argv[i], "--curved")==0 && i+1<argc)
+            curved = atof(argv[++i]);
+        else if (strcmp(argv[i], "--depth")==0 && i+1<argc)
+            depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--specks")==0 && i+1<argc)
+            specks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed")==0 && i+1<argc)
+            seed = atol(argv[++i]);
+        else if (filename==NULL && argv[i][0]!='-')
+            filename = argv[i];
+        else
+        {
+            fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (filename==NULL || width<1 || height<1 || shapes<0 || depth<1)
+    {
+        fprintf(stderr, "usage: spvec_gen FILE.png [--size WxH] [--contours N] [--length L] [--spread S]\n"
+                        "                          [--curved F] [--depth D] [--specks N] [--seed N]\n");
+        return 1;
+    }
+
+    bitmap map;
+    if (!map.init(width, height))
+    {
+        fprintf(stderr, "no memory\n");
+        return 2;
+    }
+
+    generator rnd(seed);
+
+    // grid of cells, one shape per cell
+    int cols = max(1, (int)ceil(sqrt((double)shapes*width/height)));
+    int rows = max(1, (shapes+cols-1)/cols);
+    double cw = (double)width/cols;
+    double ch = (double)height/rows;
+
+    long contours = 0;
+    long round = 0;
+    double total_length = 0;
+    vector<vertex> poly;
+
+    for (int i=0; i<shapes; i++)
+    {
+        // radius from the contour length, limited by the cell
+        double len = length * exp(spread*rnd.normal());
+        double rmax = min(cw, ch)/2 - 1;
+        double r = min(len/(2*M_PI), rmax);
+        if (r < 1.5)
+            continue;
+
+        vertex c((i%cols + 0.5)*cw + rnd.uniform(-1, 1)*(cw/2-1-r),
+                (i/cols + 0.5)*ch + rnd.uniform(-1, 1)*(ch/2-1-r));
+        bool is_curved = rnd.uniform() < curved;
+        round += is_curved;
+
+        // nested contours, at least 2 pixels apart
+        int levels = max(1, min(depth, (int)(r/2)));
+        uint64_t shape_seed = rnd.next();
+
+        for (int k=0; k<levels; k++)
+        {
+            generator shape_rnd(shape_seed);   // same shape at every level
+            make_shape(shape_rnd, is_curved, c, r*(levels-k)/levels, poly);
+            fill_polygon(map, poly, k%2==0);
+
+            for (int j=0, m=poly.size()-1; j<(int)poly.size(); m=j++)
+                total_length += (poly[j]-poly[m]).len();
+            contours++;
+        }
+    }
+
+    for (int i=0; i<specks; i++)
+    {
+        int s = 1 + (int)rnd.uniform(0, 3);
+        int x = (int)rnd.uniform(0, width);
+        int y = (int)rnd.uniform(0, height);
+        for (int dy=0; dy<s && y+dy<height; dy++)
+            for (int dx=0; dx<s && x+dx<width; dx++)
+                map.set_bit(x+dx, y+dy);
+    }
+
+    if (!map.save_png(filename))
+    {
+        fprintf(stderr, "can't write %s\n", filename);
+        return 2;
+    }
+
+    printf("{\"file\":\"%s\",\"width\":%d,\"height\":%d,\"shapes\":%d,\"curved\":%ld,\"contours\":%ld"
+        ",\"mean_length\":%.1f,\"specks\":%d,\"seed\":%ld}\n",
+        filename, width, height, shapes, round, contours,
+        contours ? total_length/contours : 0, specks, seed);
+
+    return 0;
+}
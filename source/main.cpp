@@ -17,46 +17,34 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <assert.h>
 
 #include "parameter.h"
-#include "bitmap.h"
-#include "tracer.h"
-#include "path.h"
-#include "svg.h"
-#include "sp_lines.h"
-#include "sp_bezier.h"
-
-#include "bezier.h"
-#include "area.h"
-
-
-// return the area between polylines p and q
-static bool calc_total_area(const path& p, const path& q, double max_dist, double& area)
-{
-    point* help = new point[q.size()];
-    
-    for (int i=0; i<(int)q.size(); i++)
-        help[i] = q[i];
-
-    // calculate area
-    bool ret = calc_area(&p[0], p.size(), help, q.size(), max_dist*2, area);
-    
-    delete[] help;
-
-    return ret;
-}
+#include "pipeline.h"
+#include "batch.h"
+#include "server.h"
+#include "sweep.h"
+#include "timeline.h"
+#include "disk_cache.h"
+#include "cache.h"
 
 
 int main(int argc, char** argv)
 {
     const char* filename_png = "polygon.png";
     const char* filename_svg = "out.svg";
+    const char* batch_source = NULL;    // list file, directory or "-" (stdin)
+    const char* batch_out = NULL;       // output directory of the batch mode
+    const char* socket_path = NULL;     // Unix domain socket of the server mode
+    const char* filename_timeline = NULL;   // Chrome trace events
+    const char* cache_dir = NULL;       // results on disk
+    double cache_limit = 1024;          // maximal size of the results on disk (MB)
+    int jobs = 0;                       // worker threads of the batch and server mode
+    bool sweep_mode = false;            // grid of parameter sets
+    bool sequence = false;              // batch mode over the frames of a sequence
+    vector<const char*> axes;           // "name=value,value,..." of the sweep mode
     parameter par;
-    bitmap map;
-    int rep = 1;          // repetitions for accurate time measurement
 
     if (!par.load("spvec.par"))
         par.save("spvec.par");
@@ -64,128 +52,145 @@ int main(int argc, char** argv)
     // parse parameters
     for (int i=1; i<argc; i++)
     {
-        if (strstr(argv[i],".png")!=NULL || strstr(argv[i],".PNG")!=NULL)
+        if (strcmp(argv[i], "--batch")==0 && i+1<argc)
+            batch_source = argv[++i];
+        else if (strcmp(argv[i], "--serve")==0 && i+1<argc)
+            socket_path = argv[++i];
+        else if (strcmp(argv[i], "--timeline")==0 && i+1<argc)
+            filename_timeline = argv[++i];
+        else if (strcmp(argv[i], "--cache")==0 && i+1<argc)
+            cache_dir = argv[++i];
+        else if (strcmp(argv[i], "--cache-limit")==0 && i+1<argc)
+            cache_limit = atof(argv[++i]);
+        else if (strcmp(argv[i], "--out")==0 && i+1<argc)
+            batch_out = argv[++i];
+        else if (strcmp(argv[i], "--jobs")==0 && i+1<argc)
+            jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sweep")==0)
+            sweep_mode = true;
+        else if (strcmp(argv[i], "--sequence")==0)
+            sequence = true;
+        else if (strstr(argv[i],".png")!=NULL || strstr(argv[i],".PNG")!=NULL)
             filename_png = argv[i];
         else if (strstr(argv[i],".svg")!=NULL || strstr(argv[i],".SVG")!=NULL)
             filename_svg = argv[i];
+        else if (strchr(argv[i], '=')!=NULL && strchr(argv[i], ',')!=NULL)
+            axes.push_back(argv[i]);    // checked below, --sweep may follow
         else
             par.parse(argv[i]);
     }
 
-    int ret = map.init_from_png(filename_png);
+    if (filename_timeline != NULL && socket_path != NULL)
+    {
+        fprintf(stderr, "--timeline is not supported with --serve\n");
+        return 1;
+    }
+
+    // a list of values is only an axis of the sweep mode
+    if (!sweep_mode && !axes.empty())
+    {
+        fprintf(stderr, "value list without --sweep: %s\n", axes[0]);
+        return 1;
+    }
+
+    if (cache_dir != NULL && sweep_mode)
+    {
+        fprintf(stderr, "--cache is not supported with --sweep\n");
+        return 1;
+    }
+
+    if (filename_timeline != NULL)
+        timeline::enable(1<<20);
+
+    disk_cache dc(cache_dir ? cache_dir : "", (long long)(cache_limit*1024*1024));
+    if (cache_dir != NULL && !dc.init())
+    {
+        fprintf(stderr, "can't create %s\n", cache_dir);
+        return 1;
+    }
+
+    if (socket_path != NULL)
+    {
+        server s(par);
+        return s.run(socket_path, jobs);
+    }
+
+    if (batch_source != NULL)
+    {
+        frame_cache frames;
+        batch b(par, batch_out, cache_dir ? &dc : NULL, sequence ? &frames : NULL);
+        int ret = b.run(batch_source, jobs);
+        if (filename_timeline != NULL && !timeline::write(filename_timeline))
+            fprintf(stderr, "can't write %s\n", filename_timeline);
+        return ret;
+    }
+
+    if (sweep_mode)
+    {
+        sweep sw(par, batch_out);
+        for (int i=0; i<(int)axes.size(); i++)
+            if (!sw.add_axis(axes[i]))
+            {
+                fprintf(stderr, "can't parse: %s\n", axes[i]);
+                return 1;
+            }
+        int ret = sw.run(filename_png);
+        if (filename_timeline != NULL && !timeline::write(filename_timeline))
+            fprintf(stderr, "can't write %s\n", filename_timeline);
+        return ret;
+    }
+
+    statistics st;
+    int ret = vectorize(par, filename_png, filename_svg, st, cache_dir ? &dc : NULL);
+
+    if (filename_timeline != NULL && !timeline::write(filename_timeline))
+        fprintf(stderr, "can't write %s\n", filename_timeline);
+
     if (ret!=0)
         return ret;
-    
-    tracer t(map);
 
-    svg s;
-    s.open(filename_svg);
-    s.write_header(map.get_width(), map.get_height());
-    s.write_image(map.get_width(), map.get_height(), filename_png);
-    
-    long c1 = clock();
-    
-    long t1=0, t2=0;
-    int  n=0, n1=0, n2=0, n3=0;
-    double a1=0, a2=0;
-	
-    int x, y;
-    while (t.get_next_contour(x, y))
+    // statistics of the stages that ran
+    printf("%s %d", filename_png, st.points);
+    if (st.stages >= 1)
+        printf(" | %d %.0f %.0fms", st.lines, st.area1, st.time1);
+    if (st.stages >= 3)
+        printf(" | %d %d %.0f %.1fms", st.curves, st.segments, st.area2, st.time2);
+    printf("\n");
+
+    if (par.tr_min_area > 0 && !st.cached)
+        printf("dropped %d contours (%d points) below %g pixels, about %.1f ms saved\n",
+            st.dropped, st.dropped_points, par.tr_min_area, st.dropped_saved);
+
+    if (st.cached)
+        printf("result read from the cache in %s\n", cache_dir);
+
+    if (st.anytime)
+        printf("refined %d of %d contours within %.0f ms\n",
+            (int)st.refined.size(), st.contours, par.deadline_ms);
+
+    if (par.sp_batch > 0 && !st.cached && !st.anytime)
+        printf("batched %d of %d contours in %d batches\n", st.batched, st.contours, st.batches);
+
+    if (par.cache_size > 0 && !st.cached)
+        printf("cache: %d of %d contours reused, %.1f ms saved\n",
+            st.cache_hits, st.cache_lookups, st.cache_saved);
+
+    if (par.verify && !st.cached)
     {
-        //printf("contour found: %d %d\n", x, y);
-        
-        path p, l, l2, b;
-        double cost;
-        
-        t.trace_points(x, y, par.tr_middle_points!=0, p);
-        
-        //printf("#points = %d\n", p.size());
-        n += p.size() - 1;
-
-        if (par.svg_points)
-            s.write_path(p, "blue", 0.1F, SVG_LINES|SVG_MARKER);
-            // s.write_path(p, "#B2B2B2", 0.1F, SVG_LINES|SVG_FILL);
-
-        long c2 = clock();
-
-        for (int i=0; i<rep; i++)
-        {
-            sp_lines spl(par, p);
-            spl.calculate();
-            cost = spl.extract(l);
-        }
-
-        if (par.svg_lines1)
-        {
-            // s.write_tree(p);
-            s.write_path(l, "red", 0.1F, SVG_LINES|SVG_MARKER);
-            // s.write_path(l, "red", 0.1F, SVG_LINES|SVG_MARKER|SVG_TEXT);
-        }
-
-        t1 += clock() - c2;
-
-        double area;
-        bool ret = calc_total_area(p, l, par.l_max_distance, area);
-
-        double area1;
-        bool ret1 = calc_total_area(l, p, par.l_max_distance, area1);
-
-        //printf("#lines=%d   %5.2f ms   area=%5.2f  | ret=%d area=%5.2f | (%d %5.2f)\n",
-        //    l.size()-1, (double)(clock()-c2)/rep,
-        //    cost - (l.size()-1)*par.l_cost_segment, ret, area, ret1, area1);
-
-        n1 += l.size()-1;
-        a1 += cost - (l.size()-1)*par.l_cost_segment;
-
-        c2 = clock();
-
-        for (int i=0; i<rep; i++)
-        {
-            intermediate_points(l, l2, par.b_corner_angle);
-
-            if (par.svg_lines2)
-                s.write_path(l2, "blue", 0.1F, SVG_LINES|SVG_MARKER);
-
-            sp_bezier spb(par, l2);
-            spb.calculate();
-            cost = spb.extract(b);
-        }
-
-        t2 += clock() - c2;
-
-        if (par.svg_curves)
-        {
-            s.write_path(b, "green", 0.3F, SVG_CURVES);
-            //s.write_path(b, "red", 0.3F, SVG_LINES|SVG_MARKER|SVG_TEXT);
-            s.write_path(b, "red", 0.3F, SVG_LINES|SVG_MARKER);
-            if (par.svg_control)
-                s.write_control_points(b);
-        }
-
-        // count bezier curve segments
-        int bezier = 0;
-        for (int i=1; i<(int)b.size(); i++)
-            if (b[i].flag & BEZIER)
-                bezier++;
-
-        //printf("#curves=%d line=%d   %5.2f ms   area=%5.2f\n", bezier, b.size()-bezier-1, (double)(clock()-c2)/rep,
-        //    cost - (b.size()-bezier-1)*par.b_cost_segment - (bezier)*par.b_cost_curve);
-
-        n2 += bezier;
-        n3 += b.size()-bezier-1;
-        a2 += cost - (b.size()-bezier-1)*par.b_cost_segment - bezier*par.b_cost_curve;
+        printf("verify: %d pixels differ, Hausdorff distance %.2f (%d contours, %.1f ms)\n",
+            st.check.pixels, st.check.hausdorff, st.check.contours, st.check.time);
+        for (int i=0; i<(int)st.check.worst.size(); i++)
+            printf("  contour %d: %d pixels, %.2f\n", st.check.worst[i].id,
+                st.check.worst[i].pixels, st.check.worst[i].hausdorff);
     }
 
-    printf("%s %d | %d %.0f %.0fms | %d %d %.0f %.1fms\n",
-        filename_png,
-        n,
-        n1, a1, (double)t1 * (1000.0 / CLOCKS_PER_SEC) / rep,
-        n2, n3, a2, (double)t2 * (1000.0 / CLOCKS_PER_SEC) / rep);
+    if (par.stats)
+    {
+        write_stats_json(stdout, st, par.stats);
+        printf("\n");
+    }
 
-    // printf("Zeit: %.3f s\n", double(clock()-c1)/CLOCKS_PER_SEC);
-    
-    s.write_end();
-    s.close();
+    // printf("Zeit: %.3f s\n", st.total/1000);
     
     return 0;
 }
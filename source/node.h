@@ -12,14 +12,14 @@
 class node : public point
 {
 public:
-    // double x;        // inherited
-    // double y;        // inherited
+    // coord x;         // inherited
+    // coord y;         // inherited
     double cost;        // minimal cost
     int   pred;         // list of predecessors (used in shortest_path)
     int   in_deg;       // in degree
     
     int   flag;         // CORNER, MIDDLE, BEZIER
-    double pos;         // accumulated lengths
+    double pos;         // accumulated lengths (double also with float coordinates)
     point xy[2];        // control points (BEZIER)
 
 public:
@@ -0,0 +1,183 @@
+#include "output.h"
+
+
+// writes the paths of a contour selected by the svg_* parameters
+void write_contour(svg& s, const parameter& par, const contour_paths& c)
+{
+    long long start = s.tell();
+
+    if (par.svg_points)
+        s.write_path(c.p, "blue", 0.1F, SVG_LINES|SVG_MARKER);
+        // s.write_path(c.p, "#B2B2B2", 0.1F, SVG_LINES|SVG_FILL);
+
+    if (par.svg_lines1)
+    {
+        // s.write_tree(c.p);
+        s.write_path(c.l, "red", 0.1F, SVG_LINES|SVG_MARKER);
+        // s.write_path(c.l, "red", 0.1F, SVG_LINES|SVG_MARKER|SVG_TEXT);
+    }
+
+    if (par.svg_lines2)
+        s.write_path(c.l2, "blue", 0.1F, SVG_LINES|SVG_MARKER);
+
+    if (par.svg_curves)
+    {
+        s.write_path(c.b, "green", 0.3F, SVG_CURVES);
+        //s.write_path(c.b, "red", 0.3F, SVG_LINES|SVG_MARKER|SVG_TEXT);
+        s.write_path(c.b, "red", 0.3F, SVG_LINES|SVG_MARKER);
+        if (par.svg_control)
+            s.write_control_points(c.b);
+    }
+
+    if (par.svg_index)
+    {
+        bounds b;
+        if (par.svg_points)
+            b.add(c.p);
+        if (par.svg_lines1)
+            b.add(c.l);
+        if (par.svg_lines2)
+            b.add(c.l2);
+        if (par.svg_curves)
+            b.add(c.b);
+        s.add_item(c.id, b, start);
+    }
+}
+
+
+/**
+ * Writes the paths of a batch like write_contour(), but every kind of path
+ * of all its contours as one element.
+ */
+void write_batch(svg& s, const parameter& par, const small_batch& b)
+{
+    vector<path_view> parts(b.size());
+    long long start = s.tell();
+
+    if (par.svg_points)
+    {
+        for (int k=0; k<b.size(); k++)
+            parts[k] = b.points(k);
+        s.write_paths(parts, "blue", 0.1F, SVG_LINES|SVG_MARKER);
+    }
+
+    if (par.svg_lines1)
+    {
+        for (int k=0; k<b.size(); k++)
+            parts[k] = b.lines1(k);
+        s.write_paths(parts, "red", 0.1F, SVG_LINES|SVG_MARKER);
+    }
+
+    if (par.svg_lines2)
+    {
+        for (int k=0; k<b.size(); k++)
+            parts[k] = b.lines2(k);
+        s.write_paths(parts, "blue", 0.1F, SVG_LINES|SVG_MARKER);
+    }
+
+    if (par.svg_curves)
+    {
+        for (int k=0; k<b.size(); k++)
+            parts[k] = b.result(k);
+        s.write_paths(parts, "green", 0.3F, SVG_CURVES);
+        s.write_paths(parts, "red", 0.3F, SVG_LINES|SVG_MARKER);
+        if (par.svg_control)
+            s.write_control_points(parts);
+    }
+
+    // one element of the spatial index for the whole batch
+    if (par.svg_index)
+    {
+        bounds box;
+        for (int k=0; k<b.size(); k++)
+        {
+            if (par.svg_points)
+                box.add(b.points(k));
+            if (par.svg_lines1)
+                box.add(b.lines1(k));
+            if (par.svg_lines2)
+                box.add(b.lines2(k));
+            if (par.svg_curves)
+                box.add(b.result(k));
+        }
+        s.add_item(-1, box, start);
+    }
+}
+
+
+// starts the threads if s is open and svg_queue > 0
+output_queue::output_queue(svg* s, const parameter& par) :
+    s(s), par(par), capacity(0), done(false)
+{
+    if (s!=NULL && s->is_open() && par.svg_queue > 0)
+    {
+        capacity = par.svg_queue;
+        s->set_async();
+        worker = thread(&output_queue::run, this);
+    }
+}
+
+
+// output thread
+void output_queue::run()
+{
+    unique_lock<mutex> guard(lock);
+
+    for (;;)
+    {
+        while (items.empty() && !done)
+            added.wait(guard);
+        if (items.empty())
+            return;
+
+        contour_paths c;
+        c.id = items.front().id;
+        c.p.swap(items.front().p);
+        c.l.swap(items.front().l);
+        c.l2.swap(items.front().l2);
+        c.b.swap(items.front().b);
+        items.pop_front();
+        if ((int)items.size() == capacity-1)
+            removed.notify_one();
+
+        guard.unlock();
+        write_contour(*s, par, c);
+        guard.lock();
+    }
+}
+
+
+// queues the paths of a contour (they are taken over), waits while the queue is full
+void output_queue::push(contour_paths& c)
+{
+    unique_lock<mutex> guard(lock);
+
+    while ((int)items.size() >= capacity)
+        removed.wait(guard);
+
+    items.push_back(contour_paths());
+    contour_paths& e = items.back();
+    e.id = c.id;
+    e.p.swap(c.p);
+    e.l.swap(c.l);
+    e.l2.swap(c.l2);
+    e.b.swap(c.b);
+    if (items.size() == 1)
+        added.notify_one();
+}
+
+
+// writes the remaining contours and stops the thread
+void output_queue::finish()
+{
+    if (capacity <= 0)
+        return;
+
+    {
+        lock_guard<mutex> guard(lock);
+        done = true;
+        added.notify_one();
+    }
+    worker.join();
+    capacity = 0;
+}
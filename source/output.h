@@ -0,0 +1,62 @@
+#ifndef _OUTPUT_H_
+#define _OUTPUT_H_
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "parameter.h"
+#include "path.h"
+#include "svg.h"
+#include "small_batch.h"
+
+
+// paths of a contour for the SVG output
+class contour_paths
+{
+public:
+    int  id;                // contour id (spatial index)
+    path p;                 // traced points
+    path l;                 // phase 1
+    path l2;                // intermediate points
+    path b;                 // phase 2
+};
+
+
+/**
+ * SVG output on its own thread (parameter svg_queue). The contour loop
+ * hands the finished paths over through a queue of at most svg_queue
+ * contours and only waits when the queue is full. The thread writes them
+ * in the order of push(), so the output is the same as without the queue.
+ */
+class output_queue
+{
+private:
+    svg* s;
+    const parameter& par;
+    int capacity;           // 0 = not started
+
+    deque<contour_paths> items;
+    mutex lock;
+    condition_variable added;
+    condition_variable removed;
+    bool done;
+    thread worker;
+
+    void run();
+
+public:
+    output_queue(svg* s, const parameter& par);
+    ~output_queue() { finish(); }
+
+    bool enabled() const { return capacity > 0; }
+
+    void push(contour_paths& c);
+    void finish();
+};
+
+void write_contour(svg& s, const parameter& par, const contour_paths& c);
+void write_batch(svg& s, const parameter& par, const small_batch& b);
+
+#endif
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "parameter.h"
 
@@ -7,8 +8,12 @@
 parameter::parameter()
 {
     tr_middle_points = 1;
+    tr_bands = 0;
+    tr_min_area = 0;
     sp_depth_limit = 500;
     sp_missed_limit = 10;
+    sp_adaptive = 0;
+    sp_batch = 0;
 
     l_max_distance = 1;
     l_cost_segment = 10;
@@ -27,6 +32,14 @@ parameter::parameter()
     svg_lines2 = 1;
     svg_curves = 1;
     svg_control = 1;
+    svg_fill = 0;
+    svg_queue = 0;
+    svg_index = 0;
+    deadline_ms = 0;
+    deadline_depth = 10;
+    cache_size = 0;
+    stats = 0;
+    verify = 0;
 }
 
 
@@ -35,8 +48,12 @@ bool parameter::parse(const char* str)
 {
     return
         sscanf(str, "tr_middle_points=%d", &tr_middle_points)==1 ||
+        sscanf(str, "tr_bands=%d", &tr_bands)==1 ||
+        sscanf(str, "tr_min_area=%lf", &tr_min_area)==1 ||
         sscanf(str, "sp_depth_limit=%d", &sp_depth_limit)==1 ||
         sscanf(str, "sp_missed_limit=%d", &sp_missed_limit)==1 ||
+        sscanf(str, "sp_adaptive=%d", &sp_adaptive)==1 ||
+        sscanf(str, "sp_batch=%d", &sp_batch)==1 ||
         sscanf(str, "l_max_distance=%lf", &l_max_distance)==1 ||
         sscanf(str, "l_cost_segment=%lf", &l_cost_segment)==1 ||
         sscanf(str, "l_cost_distance=%lf", &l_cost_distance)==1 ||
@@ -51,7 +68,16 @@ bool parameter::parse(const char* str)
         sscanf(str, "svg_lines1=%d", &svg_lines1)==1 ||
         sscanf(str, "svg_lines2=%d", &svg_lines2)==1 ||
         sscanf(str, "svg_curves=%d", &svg_curves)==1 ||
-        sscanf(str, "svg_control=%d", &svg_control)==1;
+        sscanf(str, "svg_control=%d", &svg_control)==1 ||
+        sscanf(str, "svg_fill=%d", &svg_fill)==1 ||
+        sscanf(str, "svg_queue=%d", &svg_queue)==1 ||
+        sscanf(str, "svg_index=%d", &svg_index)==1 ||
+        sscanf(str, "deadline_ms=%lf", &deadline_ms)==1 ||
+        sscanf(str, "deadline_depth=%d", &deadline_depth)==1 ||
+        sscanf(str, "cache_size=%d", &cache_size)==1 ||
+        sscanf(str, "stats=%d", &stats)==1 ||
+        (strncmp(str, "stats=json", 10)==0 && (stats = 10)) ||
+        sscanf(str, "verify=%d", &verify)==1;
 }
 
 
@@ -81,30 +107,59 @@ bool parameter::load(const char* filename)
 }
 
 
+// all parameters as lines "name=value" (the format of the parameter file)
+string parameter::text() const
+{
+    string s;
+    char line[100];
+    auto add = [&](const char* format, auto value)
+    {
+        snprintf(line, sizeof(line), format, value);
+        s += line;
+    };
+
+    add("tr_middle_points=%d\n", tr_middle_points);
+    add("tr_bands=%d\n", tr_bands);
+    add("tr_min_area=%f\n", tr_min_area);
+    add("sp_depth_limit=%d\n", sp_depth_limit);
+    add("sp_missed_limit=%d\n", sp_missed_limit);
+    add("sp_adaptive=%d\n", sp_adaptive);
+    add("sp_batch=%d\n", sp_batch);
+    add("l_max_distance=%f\n", l_max_distance);
+    add("l_cost_segment=%f\n", l_cost_segment);
+    add("l_cost_distance=%f\n", l_cost_distance);
+    add("l_cost_area=%f\n", l_cost_area);
+    add("b_fit_heuristic=%d\n", b_fit_heuristic);
+    add("b_corner_angle=%f\n", b_corner_angle);
+    add("b_max_distance=%f\n", b_max_distance);
+    add("b_cost_curve=%f\n", b_cost_curve);
+    add("b_cost_area=%f\n", b_cost_area);
+    add("b_cost_segment=%f\n", b_cost_segment);
+    add("svg_points=%d\n", svg_points);
+    add("svg_lines1=%d\n", svg_lines1);
+    add("svg_lines2=%d\n", svg_lines2);
+    add("svg_curves=%d\n", svg_curves);
+    add("svg_control=%d\n", svg_control);
+    add("svg_fill=%d\n", svg_fill);
+    add("svg_queue=%d\n", svg_queue);
+    add("svg_index=%d\n", svg_index);
+    add("deadline_ms=%f\n", deadline_ms);
+    add("deadline_depth=%d\n", deadline_depth);
+    add("cache_size=%d\n", cache_size);
+    add("stats=%d\n", stats);
+    add("verify=%d\n", verify);
+
+    return s;
+}
+
+
 bool parameter::save(const char* filename) const
 {
     FILE* f = fopen(filename, "w");
     if (f==NULL)
         return false;
 
-    fprintf(f, "tr_middle_points=%d\n", tr_middle_points);
-    fprintf(f, "sp_depth_limit=%d\n", sp_depth_limit);
-    fprintf(f, "sp_missed_limit=%d\n", sp_missed_limit);
-    fprintf(f, "l_max_distance=%f\n", l_max_distance);
-    fprintf(f, "l_cost_segment=%f\n", l_cost_segment);
-    fprintf(f, "l_cost_distance=%f\n", l_cost_distance);
-    fprintf(f, "l_cost_area=%f\n", l_cost_area);
-    fprintf(f, "b_fit_heuristic=%d\n", b_fit_heuristic);
-    fprintf(f, "b_corner_angle=%f\n", b_corner_angle);
-    fprintf(f, "b_max_distance=%f\n", b_max_distance);
-    fprintf(f, "b_cost_curve=%f\n", b_cost_curve);
-    fprintf(f, "b_cost_area=%f\n", b_cost_area);
-    fprintf(f, "b_cost_segment=%f\n", b_cost_segment);
-    fprintf(f, "svg_points=%d\n", svg_points);
-    fprintf(f, "svg_lines1=%d\n", svg_lines1);
-    fprintf(f, "svg_lines2=%d\n", svg_lines2);
-    fprintf(f, "svg_curves=%d\n", svg_curves);
-    fprintf(f, "svg_control=%d\n", svg_control);
+    fputs(text().c_str(), f);
 
     return fclose(f)==0;
 }
@@ -1,13 +1,21 @@
 #ifndef _PARAMETER_H_
 #define _PARAMETER_H_
 
+#include <string>
+
+using namespace std;
+
 
 class parameter
 {
 public:                         // attributes are public!
     int    tr_middle_points;    // insert points in the middle
+    int    tr_bands;            // trace in parallel bands, 0 = sequential
+    double tr_min_area;         // drop contours enclosing less pixels (specks), 0 = off
     int    sp_depth_limit;      // j-i <= sp_depth_limit
     int    sp_missed_limit;     // 
+    int    sp_adaptive;         // limits per node: 1 = depth, 2 = depth and missed, 0 = off
+    int    sp_batch;            // contours with fewer points are vectorized in batches, 0 = off
     double l_max_distance;
     double l_cost_segment;
     double l_cost_distance;
@@ -23,12 +31,21 @@ public:                         // attributes are public!
     int    svg_lines2;
     int    svg_curves;
     int    svg_control;
+    int    svg_fill;            // 1 = set pixels, 2 = clear pixels
+    int    svg_queue;           // contours queued for the output thread, 0 = write in the contour loop
+    int    svg_index;           // write a spatial index of the contours next to the SVG file
+    double deadline_ms;         // anytime mode: refine contours until this time, 0 = off
+    int    deadline_depth;      // sp_depth_limit of the first pass of the anytime mode
+    int    cache_size;          // contours kept for repeated shapes, 0 = off
+    int    stats;               // profile of the N most expensive contours, 0 = off
+    int    verify;              // compare the result with the bitmap, report the N worst contours, 0 = off
 
 public:
     parameter();
     bool parse(const char* str);
     bool load(const char* filename);
     bool save(const char* filename) const;
+    string text() const;
 };
 
 #endif
@@ -11,4 +11,67 @@ using namespace std;
 typedef vector<node> path;
 
 
+/**
+ * A path that refers to the nodes of another path instead of copying
+ * them: base[index[0]], base[index[1]], ... or, without index, the nodes
+ * base[0]..base[count-1]. The nodes and the index must not change while
+ * the view is used.
+ */
+class path_view
+{
+private:
+    const node* base;
+    const int*  index;      // NULL = consecutive nodes
+    int         count;
+
+public:
+    path_view() : base(NULL), index(NULL), count(0) {}
+    path_view(const path& p) : base(p.data()), index(NULL), count(p.size()) {}
+    path_view(const node* base, int count) : base(base), index(NULL), count(count) {}
+    path_view(const path& p, const vector<int>& index) :
+        base(p.data()), index(index.data()), count(index.size()) {}
+    path_view(const node* base, const int* index, int count) : base(base), index(index), count(count) {}
+
+    int  size() const { return count; }
+    bool empty() const { return count==0; }
+
+    const node& operator[](int i) const { return index!=NULL ? base[index[i]] : base[i]; }
+
+    // pointer-like access to the nodes (*i, i->x, i[k], i++)
+    class iterator
+    {
+    private:
+        const node* base;
+        const int*  index;
+
+    public:
+        iterator(const node* base, const int* index) : base(base), index(index) {}
+
+        const node& operator*() const { return index!=NULL ? base[*index] : *base; }
+        const node* operator->() const { return &**this; }
+        const node& operator[](int i) const { return index!=NULL ? base[index[i]] : base[i]; }
+
+        iterator operator++(int)
+        {
+            iterator old = *this;
+            if (index!=NULL)
+                index++;
+            else
+                base++;
+            return old;
+        }
+    };
+
+    iterator begin() const { return iterator(base, index); }
+
+    // copies the nodes into q
+    void copy(path& q) const
+    {
+        q.resize(count);
+        for (int i=0; i<count; i++)
+            q[i] = (*this)[i];
+    }
+};
+
+
 #endif
@@ -0,0 +1,74 @@
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "perf.h"
+
+
+const char* perf::name[PERF_EVENTS] = { "cycles", "instructions", "cache_misses", "branch_misses" };
+
+
+perf::perf()
+{
+    for (int i=0; i<PERF_EVENTS; i++)
+        fd[i] = -1;
+}
+
+
+perf::~perf()
+{
+    for (int i=0; i<PERF_EVENTS; i++)
+        if (fd[i] >= 0)
+            close(fd[i]);
+}
+
+
+int perf::open()
+{
+    int n = 0;
+
+#ifdef __linux__
+    static const uint64_t config[PERF_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+    for (int i=0; i<PERF_EVENTS; i++)
+    {
+        if (fd[i] >= 0)
+        {
+            n++;
+            continue;
+        }
+
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // this thread on any CPU
+        fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd[i] >= 0)
+            n++;
+    }
+#endif
+
+    return n;
+}
+
+
+void perf::read(uint64_t* values) const
+{
+    for (int i=0; i<PERF_EVENTS; i++)
+    {
+        values[i] = 0;
+        if (fd[i] >= 0 && ::read(fd[i], &values[i], sizeof(uint64_t)) != sizeof(uint64_t))
+            values[i] = 0;
+    }
+}
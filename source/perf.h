@@ -0,0 +1,35 @@
+#ifndef _PERF_H_
+#define _PERF_H_
+
+#include <stdint.h>
+
+
+// hardware events counted by perf
+enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_CACHE_MISSES, PERF_BRANCH_MISSES, PERF_EVENTS };
+
+
+/**
+ * Hardware performance counters of the calling thread (Linux perf_event_open,
+ * user space only). Events the kernel or the container does not allow are
+ * unavailable, the others are still counted.
+ */
+class perf
+{
+private:
+    int fd[PERF_EVENTS];    // -1 = unavailable
+
+    perf(const perf&);
+    perf& operator=(const perf&);
+
+public:
+    static const char* name[PERF_EVENTS];
+
+    perf();
+    ~perf();
+
+    int  open();                        // returns the number of available events
+    bool available(int event) const { return fd[event] >= 0; }
+    void read(uint64_t* values) const;  // current counts, 0 if unavailable
+};
+
+#endif
@@ -0,0 +1,1018 @@
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+
+#include "pipeline.h"
+#include "bitmap.h"
+#include "tracer.h"
+#include "path.h"
+#include "svg.h"
+#include "sp_lines.h"
+#include "sp_bezier.h"
+#include "timer.h"
+#include "timeline.h"
+#include "cache.h"
+#include "disk_cache.h"
+#include "output.h"
+#include "small_batch.h"
+
+
+// translate p and its control points by (dx,dy)
+void translate(path& p, double dx, double dy)
+{
+    translate(p.data(), p.size(), dx, dy);
+}
+
+
+// translate the nodes p[0]..p[n-1] and their control points by (dx,dy)
+void translate(node* p, int n, double dx, double dy)
+{
+    if (dx==0 && dy==0)
+        return;
+
+    for (int i=0; i<n; i++)
+    {
+        p[i].x += dx;
+        p[i].y += dy;
+        if (p[i].flag & BEZIER)
+            for (int k=0; k<2; k++)
+            {
+                p[i].xy[k].x += dx;
+                p[i].xy[k].y += dy;
+            }
+    }
+}
+
+
+// write every contour together with its direct children as one filled path:
+// mode 1 fills the set pixels (outer contours), mode 2 the clear pixels (holes)
+void write_filled(svg& s, const tracer& t, const vector<path>& outline, int mode)
+{
+    vector< vector<const path*> > parts(outline.size());
+
+    for (int i=0; i<(int)outline.size(); i++)
+    {
+        const contour& c = t.get_contour(i);
+        int j = c.hole==(mode==2) ? i : c.parent;
+        if (j >= 0 && !outline[i].empty())
+            parts[j].push_back(&outline[i]);
+    }
+
+    for (int i=0; i<(int)parts.size(); i++)
+    {
+        long long start = s.tell();
+        s.write_compound(parts[i], "black", SVG_LINES|SVG_CURVES);
+
+        bounds box;
+        for (int k=0; k<(int)parts[i].size(); k++)
+            box.add(*parts[i][k]);
+        s.add_item(i, box, start);
+    }
+}
+
+
+// append the profile of a contour to st
+static void add_profile(statistics& st, int id, const path& p, double time,
+                        const counters& phase1, const counters& phase2)
+{
+    contour_profile c;
+    c.id = id;
+    c.x0 = c.x1 = p.empty() ? 0 : (int)p[0].x;
+    c.y0 = c.y1 = p.empty() ? 0 : (int)p[0].y;
+    for (int i=1; i<(int)p.size(); i++)
+    {
+        c.x0 = min(c.x0, (int)floor(p[i].x));
+        c.y0 = min(c.y0, (int)floor(p[i].y));
+        c.x1 = max(c.x1, (int)ceil(p[i].x));
+        c.y1 = max(c.y1, (int)ceil(p[i].y));
+    }
+    c.points = p.size() - 1;
+    c.time = time;
+    c.phase1 = phase1;
+    c.phase2 = phase2;
+
+    st.profile.push_back(c);
+}
+
+
+// write s as JSON string
+void write_json_string(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        if (*s=='"' || *s=='\\')
+            fputc('\\', f);
+        if ((unsigned char)*s < 0x20)
+            fprintf(f, "\\u%04x", *s);
+        else
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+
+/**
+ * Writes the counters of an image and the profiles of the top most
+ * expensive contours (by time) as one line of JSON.
+ *
+ * @param f    output file
+ * @param st   statistics of the image
+ * @param top  number of contours
+ */
+void write_stats_json(FILE* f, const statistics& st, int top)
+{
+#ifdef SPVEC_COUNTERS
+    bool enabled = true;
+#else
+    bool enabled = false;
+#endif
+
+    vector<const contour_profile*> sorted;
+    for (int i=0; i<(int)st.profile.size(); i++)
+        sorted.push_back(&st.profile[i]);
+    if (top > (int)sorted.size())
+        top = sorted.size();
+    partial_sort(sorted.begin(), sorted.begin()+top, sorted.end(),
+        [](const contour_profile* a, const contour_profile* b) { return a->time > b->time; });
+
+    fprintf(f, "{\"counters\":%s,\"contours\":%d,\"phase1\":", enabled ? "true" : "false", (int)st.profile.size());
+    st.phase1.write_json(f);
+    fprintf(f, ",\"phase2\":");
+    st.phase2.write_json(f);
+    fprintf(f, ",\"top\":[");
+
+    for (int i=0; i<top; i++)
+    {
+        const contour_profile& c = *sorted[i];
+        fprintf(f, "%s{\"id\":%d,\"bbox\":[%d,%d,%d,%d],\"points\":%d,\"ms\":%.3f,\"phase1\":",
+            i ? "," : "", c.id, c.x0, c.y0, c.x1, c.y1, c.points, c.time);
+        c.phase1.write_json(f);
+        fprintf(f, ",\"phase2\":");
+        c.phase2.write_json(f);
+        fprintf(f, "}");
+    }
+
+    fprintf(f, "]");
+
+    if (st.anytime)
+    {
+        fprintf(f, ",\"refined\":[");
+        for (int i=0; i<(int)st.refined.size(); i++)
+            fprintf(f, "%s%d", i ? "," : "", st.refined[i]);
+        fprintf(f, "]");
+    }
+
+    fprintf(f, "}");
+}
+
+
+// enclosed area of a closed path (shoelace formula)
+static double enclosed_area(const path& p)
+{
+    double a = 0;
+    for (int i=1; i<(int)p.size(); i++)
+        a += p[i-1].x*p[i].y - p[i].x*p[i-1].y;
+
+    return fabs(a/2);
+}
+
+
+/**
+ * Stages needed for the output, later stages depend on the earlier ones.
+ * Without SVG document and result only the statistics are produced, they
+ * need all stages.
+ *
+ * @return 0 = tracing only, 1 = phase 1, 2 = intermediate points, 3 = phase 2
+ */
+static int needed_stages(const parameter& par, bool svg, bool result)
+{
+    if (!svg || result || par.svg_curves || par.svg_fill)
+        return 3;
+    if (par.svg_lines2)
+        return 2;
+    if (par.svg_lines1)
+        return 1;
+    return 0;
+}
+
+
+// paths and costs of a contour after the stages (see contour_stages)
+class contour_result
+{
+public:
+    vector<int> i1;         // phase 1 as nodes of the traced points
+    path   l;               // phase 1, only if written
+    path   l2;              // intermediate points
+    path   b;               // phase 2
+    int    lines;           // line segments of phase 1
+    double cost1, cost2;
+    counters k1, k2;
+    double time;            // time of the stages and of the lookup (ms)
+    bool   cached;          // phase 1 found in the contour cache
+
+    contour_result() : lines(0), cost1(0), cost2(0), time(0), cached(false) {}
+};
+
+
+/**
+ * The stages of a contour, shared by the contour loop and the anytime
+ * mode. find() takes the result from the previous frame or phase 1 from
+ * the contour cache, fit() runs phase 1, the intermediate points and
+ * phase 2 as far as the output needs them and keeps the result for the
+ * caches. All stages work in absolute coordinates, so the caches do not
+ * change the output.
+ */
+class contour_stages
+{
+public:
+    const parameter& par;
+    int  stages;            // see needed_stages()
+    contour_cache cache;
+    frame_cache* frames;    // results of the previous frame or NULL
+    bool copy_l;            // l is written
+    bool plain_l2;          // l2 is written, without the flags of phase 2
+    double t1, tm, t2;      // time of the stages (ms)
+    int  reused;            // contours taken from the previous frame
+
+    contour_stages(const parameter& par, int stages, svg* s, frame_cache* frames) :
+        par(par), stages(stages), cache(par.cache_size), frames(frames),
+        t1(0), tm(0), t2(0), reused(0)
+    {
+        copy_l = s!=NULL && par.svg_lines1;
+        plain_l2 = s!=NULL && par.svg_lines2;
+    }
+
+    // results are kept for a cache
+    bool keeping() const { return cache.enabled() || frames!=NULL; }
+
+    bool find(const path& p, contour_result& r);
+    void fit(path& p, contour_result& r);
+    void keep(const fitted& f, double time, bool hit);
+};
+
+
+/**
+ * Looks up the result of the previous frame. Otherwise phase 1 of an equal
+ * contour is taken from the cache (r.cached), and fit() runs the rest.
+ *
+ * @return true if the result is complete
+ */
+bool contour_stages::find(const path& p, contour_result& r)
+{
+    double c0 = time_ms();
+
+    const fitted* hit = frames!=NULL ? frames->find(p) : NULL;
+    if (hit != NULL)
+    {
+        r.i1 = hit->nodes;
+        r.l2 = hit->l2;
+        r.b = hit->b;
+        r.cost2 = hit->cost2;
+        reused++;
+    }
+    else
+    {
+        hit = cache.find(p);
+        if (hit == NULL)
+            return false;
+        r.i1 = hit->nodes;
+        r.cached = true;
+    }
+
+    r.lines = r.i1.size() - 1;
+    r.cost1 = hit->cost1;
+    if (!r.cached && copy_l)
+        path_view(p, r.i1).copy(r.l);
+
+    double c1 = time_ms();
+    r.time = c1 - c0;
+    timeline::record("cached", c0, c1, "points", p.size());
+
+    return !r.cached;
+}
+
+
+// runs the needed stages for p and keeps the result for the caches
+void contour_stages::fit(path& p, contour_result& r)
+{
+    double c0 = time_ms();
+    double c1;
+
+    if (stages >= 1 && !r.cached)
+    {
+        search_limits lim;
+        sp_lines spl(par, p);
+        if (par.sp_adaptive)
+        {
+            lim.calculate(par, p);
+            spl.set_limits(&lim);
+        }
+        spl.calculate();
+        r.cost1 = spl.extract(r.i1);
+        r.lines = r.i1.size() - 1;
+
+        c1 = time_ms();
+        t1 += c1 - c0;
+        r.time += c1 - c0;
+        r.k1 = spl.get_counters();
+        timeline::record("phase1", c0, c1, "points", p.size());
+        c0 = c1;
+    }
+
+    if (stages >= 1 && copy_l)
+        path_view(p, r.i1).copy(r.l);
+
+    if (stages >= 2)
+    {
+        intermediate_points(path_view(p, r.i1), r.l2, par.b_corner_angle);
+
+        c1 = time_ms();
+        tm += c1 - c0;
+        r.time += c1 - c0;
+        timeline::record("middle", c0, c1, "points", r.l2.size());
+        c0 = c1;
+    }
+
+    if (stages >= 3)
+    {
+        sp_bezier spb(par, r.l2);
+        spb.calculate();
+        r.cost2 = spb.extract(r.b);
+
+        // phase 2 marks curves in its path, the intermediate points
+        // are written without
+        if (plain_l2)
+            for (int i=0; i<(int)r.l2.size(); i++)
+                r.l2[i].flag &= ~BEZIER;
+
+        c1 = time_ms();
+        t2 += c1 - c0;
+        r.time += c1 - c0;
+        r.k2 = spb.get_counters();
+        timeline::record("phase2", c0, c1, "points", r.l2.size());
+    }
+
+    if (keeping())
+    {
+        fitted f;
+        f.p = p;
+        f.nodes = r.i1;
+        f.l2 = r.l2;
+        f.b = r.b;
+        f.cost1 = r.cost1;
+        f.cost2 = r.cost2;
+        keep(f, r.time, r.cached);
+    }
+}
+
+
+// keeps the result f for the next frame and phase 1 for the cache
+void contour_stages::keep(const fitted& f, double time, bool hit)
+{
+    if (frames!=NULL)
+        frames->insert(f);
+    if (cache.enabled())
+    {
+        if (!hit)
+            cache.insert(f);
+        cache.record(f.p.size(), time, hit);
+    }
+}
+
+
+// adds the line segments and curves of a contour to the statistics
+void count_contour(const parameter& par, int stages, int lines, double cost1,
+                   const path_view& b, double cost2, statistics& st)
+{
+    if (stages >= 1 && lines >= 0)
+    {
+        st.lines += lines;
+        st.area1 += cost1 - lines*par.l_cost_segment;
+    }
+
+    if (stages >= 3 && !b.empty())
+    {
+        int bezier = 0;
+        for (int i=1; i<b.size(); i++)
+            if (b[i].flag & BEZIER)
+                bezier++;
+
+        st.curves += bezier;
+        st.segments += b.size()-bezier-1;
+        st.area2 += cost2 - (b.size()-bezier-1)*par.b_cost_segment - bezier*par.b_cost_curve;
+    }
+}
+
+
+// hands the paths of a contour to the output and keeps its final path b in outline
+void output_contour(svg* s, const parameter& par, output_queue& queue, int id,
+                    path& p, path& l, path& l2, path& b, vector<path>* outline)
+{
+    if (outline!=NULL)
+    {
+        if ((int)outline->size() <= id)
+            outline->resize(id+1);
+        if (queue.enabled())
+            (*outline)[id] = b;
+    }
+
+    if (s!=NULL)
+    {
+        contour_paths c;
+        c.id = id;
+        c.p.swap(p);
+        c.l.swap(l);
+        c.l2.swap(l2);
+        c.b.swap(b);
+
+        if (queue.enabled())
+            queue.push(c);
+        else
+            write_contour(*s, par, c);
+
+        b.swap(c.b);
+    }
+
+    if (outline!=NULL && !queue.enabled())
+        (*outline)[id].swap(b);
+}
+
+
+// returns the final paths and the nesting of the contours
+static void return_contours(const tracer& t, vector<path>& outline,
+                            vector<path>* result, vector<contour>* nesting)
+{
+    if (result!=NULL)
+    {
+        outline.resize(t.get_contour_count());
+        result->swap(outline);
+    }
+
+    if (nesting!=NULL)
+    {
+        nesting->resize(t.get_contour_count());
+        for (int i=0; i<t.get_contour_count(); i++)
+            (*nesting)[i] = t.get_contour(i);
+    }
+}
+
+
+/**
+ * Anytime variant of vectorize() for par.deadline_ms: all contours are
+ * approximated by line segments with sp_depth_limit reduced to
+ * par.deadline_depth first. Then the contours are refined (the stages of
+ * vectorize() with the full limit) in the order of their enclosed area
+ * until the deadline. Contours whose estimated time does not fit into the
+ * remaining time are skipped in favour of smaller ones. Small contours are
+ * not batched (sp_batch), they come last.
+ */
+static void vectorize_deadline(const parameter& par, const bitmap& map, svg* s, statistics& st,
+                               vector<path>* result, vector<contour>* nesting, frame_cache* frames)
+{
+    double c0 = time_ms();
+    double deadline = c0 + par.deadline_ms;
+
+    tracer t(map);
+    if (par.tr_bands > 0)
+        t.trace_bands(par.tr_bands);
+
+    // trace all contours
+    vector<path> p;
+    vector<int> id;
+    int x, y;
+    while (t.get_next_contour(x, y))
+    {
+        p.resize(p.size()+1);
+        id.push_back(t.trace_points(x, y, par.tr_middle_points!=0, p.back()));
+
+        // drop specks
+        if (t.get_contour(id.back()).area < par.tr_min_area)
+        {
+            st.dropped++;
+            st.dropped_points += p.back().size() - 1;
+            p.pop_back();
+            id.pop_back();
+        }
+    }
+    int n = p.size();
+
+    double c1 = time_ms();
+    st.time_trace = c1 - c0;
+    timeline::record("trace", c0, c1, "contours", n);
+
+    // fast pass: lines only with reduced depth
+    parameter fast = par;
+    fast.sp_depth_limit = min(par.deadline_depth, par.sp_depth_limit);
+
+    vector<path> l(n), b(n), l2(n);
+    vector<double> cost1(n);
+    vector<int> lines(n);
+    int points = 0;
+
+    for (int i=0; i<n; i++)
+    {
+        sp_lines spl(fast, p[i]);
+        spl.calculate();
+        cost1[i] = spl.extract(l[i]);
+        lines[i] = l[i].size() - 1;
+        b[i] = l[i];
+        points += p[i].size() - 1;
+        st.phase1.add(spl.get_counters());
+    }
+
+    double c2 = time_ms();
+    double fast_ms = c2 - c1;
+    timeline::record("phase1", c1, c2, "points", points);
+
+    // refine the largest contours first
+    vector<double> area(n);
+    vector<int> order(n);
+    for (int i=0; i<n; i++)
+    {
+        area[i] = enclosed_area(p[i]);
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&area](int a, int b) { return area[a] > area[b]; });
+
+    int stages = needed_stages(par, s!=NULL, result!=NULL);
+    contour_stages cs(par, stages, s, frames);
+
+    // time per point and depth of the refinement, estimated from the fast pass at first
+    double rate = points ? fast_ms/points * par.sp_depth_limit/max(1, fast.sp_depth_limit) : 0;
+    double refine_ms = 0;
+    int    refine_points = 0;
+    vector<char> refined(n, 0);
+    vector<double> cost2(n);
+
+    for (int k=0; k<n; k++)
+    {
+        int i = order[k];
+        double c3 = time_ms();
+        if (c3 >= deadline)
+            break;
+        if (c3 + rate*(p[i].size()-1) > deadline)
+            continue;
+
+        contour_result r;
+        if (!cs.find(p[i], r))
+            cs.fit(p[i], r);
+
+        st.phase1.add(r.k1);
+        st.phase2.add(r.k2);
+        if (par.stats)
+            add_profile(st, id[i], p[i], r.time, r.k1, r.k2);
+
+        double c4 = time_ms();
+        timeline::record("refine", c3, c4, "id", id[i]);
+
+        lines[i] = r.lines;
+        cost1[i] = r.cost1;
+        cost2[i] = r.cost2;
+        l[i].swap(r.l);
+        l2[i].swap(r.l2);
+        b[i].swap(r.b);
+        refined[i] = 1;
+
+        // measured rate of the refinement
+        refine_ms += c4 - c3;
+        refine_points += p[i].size() - 1;
+        rate = refine_ms / refine_points;
+    }
+
+    double c3 = time_ms();
+
+    // output in the order of the contours
+    vector<path> outline;
+    bool keep = result!=NULL || (s!=NULL && par.svg_fill);
+    if (keep)
+        outline.resize(t.get_contour_count());
+    output_queue queue(s, par);
+
+    for (int i=0; i<n; i++)
+    {
+        st.points += p[i].size() - 1;
+
+        if (refined[i])
+        {
+            count_contour(par, stages, lines[i], cost1[i], b[i], cost2[i], st);
+            st.refined.push_back(id[i]);
+        }
+        else
+        {
+            // the lines of the fast pass are the result
+            count_contour(par, min(stages, 1), lines[i], cost1[i], b[i], 0, st);
+            if (stages >= 3)
+            {
+                st.segments += lines[i];
+                st.area2 += cost1[i] - lines[i]*par.l_cost_segment;
+            }
+        }
+
+        output_contour(s, par, queue, id[i], p[i], l[i], l2[i], b[i], keep ? &outline : NULL);
+    }
+
+    queue.finish();
+
+    if (s!=NULL && par.svg_fill)
+        write_filled(*s, t, outline, par.svg_fill);
+
+    double c4 = time_ms();
+    st.time1 = fast_ms + cs.t1;
+    st.time_middle = cs.tm;
+    st.time2 = cs.t2;
+    st.time_output = c4 - c3;
+    st.contours = n;
+    st.anytime = true;
+    st.stages = stages;
+    st.cache_lookups = cs.cache.lookups;
+    st.cache_hits = cs.cache.hits;
+    st.cache_saved = cs.cache.saved();
+    st.reused = cs.reused;
+    timeline::record("output", c3, c4, "contours", n);
+
+    return_contours(t, outline, result, nesting);
+}
+
+
+// the contour loop of vectorize()
+static void vectorize_contours(const parameter& par, const bitmap& map, svg* s, statistics& st,
+                               vector<path>* result, vector<contour>* nesting, frame_cache* frames)
+{
+    double c0 = time_ms();
+
+    tracer t(map);
+    if (par.tr_bands > 0)
+        t.trace_bands(par.tr_bands);
+
+    double c1 = time_ms();
+    timeline::record("tracer", c0, c1, "bands", par.tr_bands);
+    double tt=c1-c0, to=0;
+    vector<path> outline;   // final path of every contour (svg_fill, result)
+    bool keep = result!=NULL || (s!=NULL && par.svg_fill);
+
+    int stages = needed_stages(par, s!=NULL, result!=NULL);
+
+    contour_stages cs(par, stages, s, frames);
+    output_queue queue(s, par);
+
+    // small contours (sp_batch), not with per contour profiles or the output thread
+    small_batch batch;
+    bool batching = par.sp_batch > 0 && !par.stats && !queue.enabled();
+
+    // vectorizes and writes the contours collected in batch
+    auto run_batch = [&]()
+    {
+        if (batch.size() == 0)
+            return;
+
+        double times[3];
+        double c3 = time_ms();
+        batch.solve(par, stages, times);
+        cs.t1 += times[0];
+        cs.tm += times[1];
+        cs.t2 += times[2];
+        st.phase1.add(batch.k1);
+        st.phase2.add(batch.k2);
+
+        double c4 = time_ms();
+        timeline::record("batch", c3, c4, "contours", batch.size());
+
+        int points = 0;
+        for (int k=0; k<batch.size(); k++)
+            points += batch.points(k).size();
+
+        for (int k=0; k<batch.size(); k++)
+        {
+            path_view b = batch.result(k);
+            count_contour(par, stages, batch.lines1(k).size()-1, batch.cost1[k], b, batch.cost2[k], st);
+
+            if (cs.keeping())
+            {
+                fitted f;
+                batch.points(k).copy(f.p);
+                batch.nodes1(k, f.nodes);
+                batch.lines2(k).copy(f.l2);
+                b.copy(f.b);
+                f.cost1 = batch.cost1[k];
+                f.cost2 = batch.cost2[k];
+                cs.keep(f, (c4-c3)*f.p.size()/points, false);
+            }
+        }
+
+        if (keep)
+            for (int k=0; k<batch.size(); k++)
+            {
+                int id = batch.id[k];
+                if ((int)outline.size() <= id)
+                    outline.resize(id+1);
+                batch.result(k).copy(outline[id]);
+            }
+
+        if (s!=NULL)
+            write_batch(*s, par, batch);
+
+        double c5 = time_ms();
+        to += c5 - c4;
+        timeline::record("output", c4, c5, "contours", batch.size());
+        st.batched += batch.size();
+        st.batches++;
+        batch.clear();
+    };
+
+    int x, y;
+    while (t.get_next_contour(x, y))
+    {
+        //printf("contour found: %d %d\n", x, y);
+
+        path p;
+        contour_result r;
+
+        int id = t.trace_points(x, y, par.tr_middle_points!=0, p);
+
+        double c2 = time_ms();
+        tt += c2 - c1;
+        timeline::record("trace", c1, c2, "points", p.size());
+        double cc = c1;
+
+        // specks are dropped before any optimization, their path stays empty
+        if (t.get_contour(id).area < par.tr_min_area)
+        {
+            st.dropped++;
+            st.dropped_points += p.size() - 1;
+            c1 = c2;
+            continue;
+        }
+
+        //printf("#points = %d\n", p.size());
+        st.points += p.size() - 1;
+
+        if (!cs.find(p, r))
+        {
+            if (batching && !r.cached && (int)p.size() < par.sp_batch)
+            {
+                batch.add(id, p);
+                if (batch.full())
+                    run_batch();
+
+                c1 = time_ms();
+                continue;
+            }
+
+            cs.fit(p, r);
+        }
+
+        double c3 = time_ms();
+
+        st.phase1.add(r.k1);
+        st.phase2.add(r.k2);
+
+        if (par.stats)
+            add_profile(st, id, p, r.time, r.k1, r.k2);
+
+        count_contour(par, stages, r.lines, r.cost1, r.b, r.cost2, st);
+
+        output_contour(s, par, queue, id, p, r.l, r.l2, r.b, keep ? &outline : NULL);
+
+        c1 = time_ms();
+        to += c1 - c3;
+        timeline::record("contour", cc, c1, "id", id);
+    }
+
+    tt += time_ms() - c1;
+    run_batch();
+
+    // the output thread writes the rest, the time waited counts as output
+    double c4 = time_ms();
+    queue.finish();
+    to += time_ms() - c4;
+
+    c1 = time_ms();
+    if (s!=NULL && par.svg_fill)
+        write_filled(*s, t, outline, par.svg_fill);
+    double c2 = time_ms();
+    to += c2 - c1;
+    timeline::record("output", c1, c2, "contours", t.get_contour_count());
+
+    st.time1 = cs.t1;
+    st.time2 = cs.t2;
+    st.time_trace = tt;
+    st.time_middle = cs.tm;
+    st.time_output = to;
+    st.contours = t.get_contour_count();
+    st.cache_lookups = cs.cache.lookups;
+    st.cache_hits = cs.cache.hits;
+    st.cache_saved = cs.cache.saved();
+    st.reused = cs.reused;
+    st.stages = stages;
+
+    return_contours(t, outline, result, nesting);
+}
+
+
+/**
+ * Vectorizes a bitmap. The paths are written to the SVG document s (without
+ * header and end) and/or returned in result.
+ *
+ * @param par      parameters
+ * @param map      the bitmap
+ * @param s        open SVG document or NULL
+ * @param st       statistics (return)
+ * @param result   final path of every contour or NULL (return)
+ * @param nesting  nesting information of every contour or NULL (return)
+ * @param frames   results of the previous frame (sequence mode) or NULL,
+ *                 next_frame() must have been called for map
+ */
+void vectorize(const parameter& par, const bitmap& map, svg* s, statistics& st,
+               vector<path>* result, vector<contour>* nesting, frame_cache* frames)
+{
+    // the stages add to the statistics
+    st = statistics();
+
+    // the comparison needs the final paths
+    vector<path> outline;
+    if (par.verify && result==NULL)
+        result = &outline;
+
+    if (par.deadline_ms > 0)
+        vectorize_deadline(par, map, s, st, result, nesting, frames);
+    else
+        vectorize_contours(par, map, s, st, result, nesting, frames);
+
+    // the dropped specks at the mean time per point of the stages after tracing
+    if (st.points > 0)
+        st.dropped_saved = (st.time1 + st.time_middle + st.time2) / st.points * st.dropped_points;
+
+    if (par.verify)
+        verify(map, *result, par.verify, st.check);
+}
+
+
+// svg_sink appending to a string
+static size_t append(void* ctx, const char* data, size_t len)
+{
+    ((string*)ctx)->append(data, len);
+    return len;
+}
+
+
+// vectorize() of a PNG file with the disk cache
+static int vectorize_cached(const parameter& par, const char* filename_png, const char* filename_svg,
+                            statistics& st, disk_cache& dc, frame_cache* frames)
+{
+    double c0 = time_ms();
+
+    vector<char> png;
+    FILE* f = fopen(filename_png, "rb");
+    if (f==NULL)
+        return -1;
+    char buf[65536];
+    for (size_t len; (len = fread(buf, 1, sizeof(buf), f)) > 0; )
+        png.insert(png.end(), buf, buf+len);
+    fclose(f);
+
+    uint64_t key = disk_cache::key(png, par);
+    cached_result r;
+
+    if (dc.find(key, png.size(), par, r))
+    {
+        svg s;
+        if (!s.open(filename_svg))
+            return -5;
+        s.write_header(r.width, r.height);
+        s.write_image(r.width, r.height, filename_png);
+        s.write_raw(r.body.data(), r.body.size());
+        s.write_end();
+        if (!s.close())
+            return -5;
+
+        st.points = r.points;
+        st.lines = r.lines;
+        st.area1 = r.area1;
+        st.curves = r.curves;
+        st.segments = r.segments;
+        st.area2 = r.area2;
+        st.contours = r.contours;
+        st.stages = needed_stages(par, true, false);
+        st.cached = true;
+        st.total = time_ms() - c0;
+        timeline::record("cached", c0, time_ms(), "bytes", (long)r.body.size());
+        return 0;
+    }
+
+    bitmap map;
+    int ret = map.init_from_png_data(png.data(), png.size());
+    if (ret!=0)
+        return ret;
+
+    double c1 = time_ms();
+
+    svg s;
+    if (!s.open(filename_svg))
+        return -5;
+    s.write_header(map.get_width(), map.get_height());
+    s.write_image(map.get_width(), map.get_height(), filename_png);
+
+    // the output of the contours is kept for the cache
+    svg b;
+    b.open(append, &r.body);
+
+    double c2 = time_ms();
+
+    if (frames!=NULL)
+        frames->next_frame(map);
+    vectorize(par, map, &b, st, NULL, NULL, frames);
+
+    double c3 = time_ms();
+    b.close();
+    s.write_raw(r.body.data(), r.body.size());
+    s.write_end();
+    if (!s.close())
+        return -5;
+
+    r.width = map.get_width();
+    r.height = map.get_height();
+    r.points = st.points;
+    r.lines = st.lines;
+    r.area1 = st.area1;
+    r.curves = st.curves;
+    r.segments = st.segments;
+    r.area2 = st.area2;
+    r.contours = st.contours;
+    dc.insert(key, png.size(), par, r);
+
+    timeline::record("decode", c0, c1, "pixels", (long)map.get_width()*map.get_height());
+    timeline::record("output", c1, c2);
+    timeline::record("output", c3, time_ms());
+
+    st.time_decode = c1 - c0;
+    st.time_output += c2 - c1 + time_ms() - c3;
+    st.total = time_ms() - c0;
+
+    return 0;
+}
+
+
+/**
+ * Vectorizes a bi-level PNG file and writes the result as SVG file.
+ *
+ * @param par           parameters
+ * @param filename_png  the PNG file to be read
+ * @param filename_svg  the SVG file to be written
+ * @param st            statistics (return)
+ * @param dc            disk cache of the results or NULL
+ * @param frames        results of the previous frame (sequence mode) or NULL
+ *
+ * @return 0=OK, -1..-4 see bitmap::init_from_png(), -5=can't write SVG file (or its index)
+ */
+int vectorize(const parameter& par, const char* filename_png, const char* filename_svg, statistics& st,
+              disk_cache* dc, frame_cache* frames)
+{
+    // the cache has no index (svg_index)
+    if (dc!=NULL && !par.svg_index)
+        return vectorize_cached(par, filename_png, filename_svg, st, *dc, frames);
+
+    bitmap map;
+    double c0 = time_ms();
+
+    int ret = map.init_from_png(filename_png);
+    if (ret!=0)
+        return ret;
+
+    double c1 = time_ms();
+
+    svg s;
+    if (!s.open(filename_svg))
+        return -5;
+    s.write_header(map.get_width(), map.get_height());
+    s.write_image(map.get_width(), map.get_height(), filename_png);
+
+    spatial_index index;
+    if (par.svg_index)
+        s.set_index(&index);
+
+    double c2 = time_ms();
+
+    if (frames!=NULL)
+        frames->next_frame(map);
+    vectorize(par, map, &s, st, NULL, NULL, frames);
+
+    double c3 = time_ms();
+    s.write_end();
+    if (!s.close())
+        return -5;
+
+    if (par.svg_index && !index.save((string(filename_svg) + ".idx").c_str()))
+        return -5;
+
+    timeline::record("decode", c0, c1, "pixels", (long)map.get_width()*map.get_height());
+    timeline::record("output", c1, c2);
+    timeline::record("output", c3, time_ms());
+
+    st.time_decode = c1 - c0;
+    st.time_output += c2 - c1 + time_ms() - c3;
+    st.total = time_ms() - c0;
+    
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include "parameter.h"
+#include "bitmap.h"
+#include "path.h"
+#include "tracer.h"
+#include "svg.h"
+#include "counters.h"
+#include "verify.h"
+
+class disk_cache;
+class frame_cache;
+class output_queue;
+
+
+// profile of a contour (parameter stats)
+class contour_profile
+{
+public:
+    int    id;              // contour id (see tracer)
+    int    x0, y0, x1, y1;  // bounding box
+    int    points;          // traced points
+    double time;            // time for phase 1, intermediate points and phase 2 (ms)
+    counters phase1;
+    counters phase2;
+};
+
+
+// statistics of a vectorized image
+class statistics
+{
+public:
+    int    points;          // traced points
+    int    lines;           // line segments (phase 1)
+    double area1;           // area between contours and line segments
+    double time1;           // time for phase 1 (ms)
+    int    curves;          // Bézier curve segments (phase 2)
+    int    segments;        // line segments (phase 2)
+    double area2;           // area between contours and phase 2 segments
+    double time2;           // time for phase 2 (ms)
+    double time_decode;     // time for reading the PNG (ms)
+    double time_trace;      // time for tracing the contours (ms)
+    double time_middle;     // time for intermediate_points() (ms)
+    double time_output;     // time for writing the SVG (ms)
+    double total;           // time from reading the PNG to closing the SVG (ms)
+    int    contours;        // traced contours
+    counters phase1;        // summed over all contours
+    counters phase2;
+    vector<contour_profile> profile;    // every contour (parameter stats)
+    bool   anytime;         // result of the deadline mode (deadline_ms)
+    vector<int> refined;    // ids of the contours refined before the deadline
+    int    cache_lookups;   // contours looked up in the cache (cache_size)
+    int    cache_hits;      // contours taken from the cache
+    double cache_saved;     // time of the calculations saved minus the time of the hits (ms)
+    bool   cached;          // result read from the disk cache (option --cache)
+    int    reused;          // contours taken from the previous frame (sequence mode)
+    int    dropped;         // specks dropped after tracing (tr_min_area)
+    int    dropped_points;  // their traced points (not counted in points)
+    double dropped_saved;   // estimated time of the stages saved by dropping them (ms)
+    int    stages;          // stages run for the output: 1 = phase 1, 2 = intermediate points, 3 = phase 2
+    int    batched;         // contours vectorized in batches (sp_batch)
+    int    batches;
+    fidelity check;         // result compared with the bitmap (verify)
+
+    statistics() : points(0), lines(0), area1(0), time1(0),
+        curves(0), segments(0), area2(0), time2(0),
+        time_decode(0), time_trace(0), time_middle(0), time_output(0), total(0),
+        contours(0), anytime(false), cache_lookups(0), cache_hits(0), cache_saved(0),
+        cached(false), reused(0), dropped(0), dropped_points(0), dropped_saved(0),
+        stages(3), batched(0), batches(0) {}
+};
+
+
+void vectorize(const parameter& par, const bitmap& map, svg* s, statistics& st,
+               vector<path>* result, vector<contour>* nesting, frame_cache* frames = NULL);
+void write_stats_json(FILE* f, const statistics& st, int top);
+void write_json_string(FILE* f, const char* s);
+void count_contour(const parameter& par, int stages, int lines, double cost1,
+                   const path_view& b, double cost2, statistics& st);
+void output_contour(svg* s, const parameter& par, output_queue& queue, int id,
+                    path& p, path& l, path& l2, path& b, vector<path>* outline);
+void write_filled(svg& s, const tracer& t, const vector<path>& outline, int mode);
+void translate(path& p, double dx, double dy);
+void translate(node* p, int n, double dx, double dy);
+int  vectorize(const parameter& par, const char* filename_png, const char* filename_svg, statistics& st,
+                disk_cache* dc = NULL, frame_cache* frames = NULL);
+
+#endif
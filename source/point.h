@@ -4,84 +4,112 @@
 #include <math.h>
 
 
-class point
+// coordinates of the points of the pipeline (make FLOAT=1: single precision)
+#ifdef SPVEC_FLOAT
+typedef float  coord;
+#else
+typedef double coord;
+#endif
+
+
+/**
+ * Point or vector with coordinates of type T. Lengths and products are
+ * calculated in double for both types, so float coordinates only round
+ * the stored values.
+ */
+template<class T>
+class point_t
 {
 public:
-    double x;
-    double y;
+    T x;
+    T y;
 
-    point() {}
+    point_t() {}
 
-    point(double x, double y)
+    point_t(T x, T y)
     {
         this->x = x;
         this->y = y;
     }
 
+    // conversion from the other precision
+    template<class U>
+    explicit point_t(const point_t<U>& p) : x((T)p.x), y((T)p.y) {}
+
     // vector addition
-    point operator+(point p) const
+    point_t operator+(point_t p) const
     {
-        return point(x+p.x, y+p.y);
+        return point_t(x+p.x, y+p.y);
     }
 
     // vector difference
-    point operator-(point p) const
+    point_t operator-(point_t p) const
     {
-        return point(x-p.x, y-p.y);
+        return point_t(x-p.x, y-p.y);
     }
 
     // length squared
     double len2() const
     {
-        return x*x+y*y;
+        return (double)x*x + (double)y*y;
     }
 
     // length
     double len() const
     {
-        return sqrt(x*x+y*y);
+        return sqrt(len2());
     }
 
-    bool operator==(const point& p) const
+    bool operator==(const point_t& p) const
     {
         return x==p.x && y==p.y;
     }
 };
 
 
+typedef point_t<coord>  point;
+typedef point_t<double> vertex;     // double in both precisions
+
+
 // scalar multiplication
-inline point operator*(double a, point p)
+template<class T>
+inline point_t<T> operator*(double a, point_t<T> p)
 {
-    return point(a*p.x, a*p.y);
+    return point_t<T>(a*p.x, a*p.y);
 }
 
-inline point operator*(point p, double a)
+template<class T>
+inline point_t<T> operator*(point_t<T> p, double a)
 {
-    return point(a*p.x, a*p.y);
+    return point_t<T>(a*p.x, a*p.y);
 }
 
 
 
 // inner dot product
-inline double dot(point a, point b)
+template<class T>
+inline double dot(point_t<T> a, point_t<T> b)
 {
-    return a.x*b.x + a.y*b.y;
+    return (double)a.x*b.x + (double)a.y*b.y;
 }
 
 // perpendicular product
-inline double cross(point a, point b)
+template<class T>
+inline double cross(point_t<T> a, point_t<T> b)
 {
-    return a.x*b.y - a.y*b.x;
+    return (double)a.x*b.y - (double)a.y*b.x;
 }
 
 // normal (perpendicular) vector
-inline point perp(point p)
+template<class T>
+inline point_t<T> perp(point_t<T> p)
 {
-    return point(-p.y, p.x);
+    return point_t<T>(-p.y, p.x);
 }
 
 // cosine of angle between a and b
-inline double cos_alpha(point a, point b)
+template<class T>
+inline double cos_alpha(point_t<T> a, point_t<T> b)
 {
     return dot(a, b) / sqrt(a.len2()*b.len2());
 }
@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+
+#include "server.h"
+#include "spvec.h"
+#include "timer.h"
+
+
+#define MAX_REQUEST (1<<30)     // largest bitmap accepted (bytes)
+
+
+// buffered reading from a socket
+class reader
+{
+private:
+    int  fd;
+    char buf[65536];
+    int  pos, len;
+
+    bool fill()
+    {
+        do
+            len = read(fd, buf, sizeof(buf));
+        while (len<0 && errno==EINTR);
+
+        pos = 0;
+        return len > 0;
+    }
+
+public:
+    reader(int fd) : fd(fd), pos(0), len(0) {}
+
+    // read a line without '\n', false = end of connection
+    bool read_line(string& line)
+    {
+        line.clear();
+        for (;;)
+        {
+            if (pos==len && !fill())
+                return false;
+
+            char* end = (char*)memchr(buf+pos, '\n', len-pos);
+            if (end != NULL)
+            {
+                line.append(buf+pos, end);
+                pos = end-buf+1;
+                return true;
+            }
+
+            line.append(buf+pos, buf+len);
+            pos = len;
+            if (line.size() > 65536)
+                return false;
+        }
+    }
+
+    // read exactly n bytes
+    bool read_data(vector<unsigned char>& data, size_t n)
+    {
+        data.resize(n);
+        size_t got = 0;
+
+        while (got < n)
+        {
+            if (pos==len && !fill())
+                return false;
+
+            size_t k = min(n-got, (size_t)(len-pos));
+            memcpy(&data[got], buf+pos, k);
+            got += k;
+            pos += k;
+        }
+
+        return true;
+    }
+};
+
+
+static bool write_all(int fd, const char* data, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t k = send(fd, data, n, MSG_NOSIGNAL);
+        if (k < 0 && errno==EINTR)
+            continue;
+        if (k <= 0)
+            return false;
+        data += k;
+        n -= k;
+    }
+
+    return true;
+}
+
+
+// svg_sink appending to a vector<char>
+static size_t append(void* ctx, const char* data, size_t len)
+{
+    vector<char>* out = (vector<char>*)ctx;
+    out->insert(out->end(), data, data+len);
+    return len;
+}
+
+
+// latency percentiles as JSON
+string server::stats()
+{
+    vector<double> sorted;
+    long n, f;
+    {
+        lock_guard<mutex> guard(lock);
+        sorted = latency;
+        n = requests;
+        f = failed;
+    }
+    sort(sorted.begin(), sorted.end());
+
+    char line[256];
+    snprintf(line, sizeof(line),
+        "{\"requests\":%ld,\"failed\":%ld,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}\n",
+        n, f, percentile(sorted, 50), percentile(sorted, 90), percentile(sorted, 99),
+        sorted.empty() ? 0 : sorted.back());
+
+    return line;
+}
+
+
+// vectorize a request and write the answer
+void server::answer(job& j, vector<char>& out)
+{
+    out.clear();
+    int ret = j.w==0 ?
+        spvec_vectorize(j.par, j.size ? j.data : NULL, j.size, append, &out, NULL) :
+        spvec_vectorize(j.par, j.data, j.w, j.h, j.stride, append, &out, NULL);
+
+    if (ret != 0)
+        out.clear();
+
+    // counted before the reply, so a stats request after it includes it
+    double ms = time_ms() - j.start;
+    {
+        lock_guard<mutex> guard(lock);
+        if (latency.size() < SERVER_SAMPLES)
+            latency.push_back(ms);
+        else
+            latency[requests % SERVER_SAMPLES] = ms;
+        requests++;
+        if (ret != 0)
+            failed++;
+    }
+
+    char head[64];
+    snprintf(head, sizeof(head), "%d %d\n", ret, (int)out.size());
+    j.ok = write_all(j.fd, head, strlen(head)) &&
+           (out.empty() || write_all(j.fd, &out[0], out.size()));
+}
+
+
+// connection thread: read the requests of a connection and pass them to the workers
+void server::serve(int fd)
+{
+    reader in(fd);
+    string line;
+    vector<unsigned char> data;
+
+    while (in.read_line(line))
+    {
+        if (line=="stats")
+        {
+            string s = stats();
+            char head[64];
+            snprintf(head, sizeof(head), "0 %d\n", (int)s.size());
+            if (!write_all(fd, head, strlen(head)) || !write_all(fd, s.data(), s.size()))
+                break;
+            continue;
+        }
+
+        job j;
+        j.par = par;
+        j.w = j.h = j.stride = 0;
+        j.fd = fd;
+        j.start = time_ms();
+        j.done = false;
+        j.ok = false;
+
+        // header: format, size and parameter overrides
+        long size = 0;
+        int  n = 0;
+        bool ok = false;
+
+        if (sscanf(line.c_str(), "png %ld%n", &size, &n)==1)
+            ok = true;
+        else if (sscanf(line.c_str(), "bits %d %d %d%n", &j.w, &j.h, &j.stride, &n)==3 &&
+                 j.w>0 && j.h>0 && j.w<=BITMAP_MAX_SIDE && j.h<=BITMAP_MAX_SIDE && j.stride>=(j.w+7)/8)
+        {
+            size = (long)j.h*j.stride;
+            ok = true;
+        }
+
+        if (!ok || size<0 || size>MAX_REQUEST)
+        {
+            fprintf(stderr, "bad request: %.100s\n", line.c_str());
+            break;
+        }
+
+        char* save;
+        for (char* tok = strtok_r(&line[n], " \t", &save); tok!=NULL; tok = strtok_r(NULL, " \t", &save))
+            j.par.parse(tok);
+
+        if (!in.read_data(data, size))
+            break;
+        j.data = size ? &data[0] : NULL;
+        j.size = size;
+
+        // wait for a worker
+        unique_lock<mutex> guard(lock);
+        queue.push_back(&j);
+        ready.notify_one();
+        finished.wait(guard, [&j]{ return j.done; });
+
+        if (!j.ok)
+            break;
+    }
+
+    close(fd);
+}
+
+
+// worker thread: vectorize requests from the queue
+void server::work()
+{
+    vector<char> out;       // output buffer, kept across requests
+
+    for (;;)
+    {
+        job* j;
+        {
+            unique_lock<mutex> guard(lock);
+            ready.wait(guard, [this]{ return !queue.empty(); });
+            j = queue.front();
+            queue.pop_front();
+        }
+
+        answer(*j, out);
+
+        lock_guard<mutex> guard(lock);
+        j->done = true;
+        finished.notify_all();
+    }
+}
+
+
+/**
+ * Listens on a Unix domain socket and serves requests until the process
+ * is terminated.
+ *
+ * @param socket_path  path of the socket, an existing socket is replaced
+ * @param jobs         number of worker threads, 0 = number of cores
+ *
+ * @return -1=can't create socket or the path is no socket (returns only on errors)
+ */
+int server::run(const char* socket_path, int jobs)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    // only a socket left by an earlier server is removed
+    struct stat info;
+    if (lstat(socket_path, &info) == 0)
+    {
+        if (!S_ISSOCK(info.st_mode))
+        {
+            fprintf(stderr, "not a socket: %s\n", socket_path);
+            return -1;
+        }
+        if (unlink(socket_path) != 0)
+        {
+            perror(socket_path);
+            return -1;
+        }
+    }
+    else if (errno != ENOENT)
+    {
+        perror(socket_path);
+        return -1;
+    }
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener<0 || bind(listener, (sockaddr*)&addr, sizeof(addr))!=0 || listen(listener, 128)!=0)
+    {
+        perror(socket_path);
+        return -1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (jobs <= 0)
+        jobs = thread::hardware_concurrency();
+    if (jobs <= 0)
+        jobs = 1;
+
+    // warm workers, waiting for requests
+    for (int i=0; i<jobs; i++)
+        thread(&server::work, this).detach();
+
+    fprintf(stderr, "listening on %s with %d workers\n", socket_path, jobs);
+
+    for (;;)
+    {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno==EINTR || errno==ECONNABORTED)
+                continue;
+            perror("accept");
+            return -1;
+        }
+
+        thread(&server::serve, this, fd).detach();
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#include "parameter.h"
+#include "path.h"
+
+
+#define SERVER_SAMPLES 100000  // latencies kept for the percentiles
+
+
+/**
+ * Vectorization service on a Unix domain socket. Every connection has a
+ * thread reading its requests, the requests are vectorized by a pool of
+ * worker threads started once, which keep their output buffers across
+ * requests. A connection carries any number of requests, each of them a
+ * header line followed by the bitmap:
+ *
+ *   png SIZE [name=value ...]\n            + SIZE bytes of a PNG file
+ *   bits W H STRIDE [name=value ...]\n     + H*STRIDE bytes, 1 bit per pixel
+ *   stats\n                                latency percentiles as JSON
+ *
+ * The answer is a line "STATUS LENGTH\n" followed by LENGTH bytes of SVG
+ * (or JSON), STATUS is 0 or an error code of spvec_vectorize().
+ */
+class server
+{
+private:
+    // a request waiting for a worker
+    class job
+    {
+    public:
+        parameter par;
+        const unsigned char* data;
+        size_t size;
+        int    w, h, stride;    // w = 0: PNG data
+        int    fd;              // connection for the answer
+        double start;           // time the request was read (ms)
+        bool   done;
+        bool   ok;              // answer written
+    };
+
+    const parameter& par;   // defaults, overridden per request
+
+    int    listener;
+    mutex  lock;            // guards the queue, the jobs and the latencies
+    condition_variable ready;
+    condition_variable finished;
+    deque<job*> queue;
+    vector<double> latency; // ms of the last SERVER_SAMPLES requests
+    long   requests;
+    long   failed;
+
+    void work();
+    void answer(job& j, vector<char>& out);
+    void serve(int fd);
+    string stats();
+
+public:
+    server(const parameter& par) : par(par), listener(-1), requests(0), failed(0) {}
+
+    int run(const char* socket_path, int jobs);
+};
+
+#endif
@@ -15,39 +15,62 @@ const double INFINITY = (double)1e20;
 
 
 bool shortest_path::calculate()
+{
+    return calculate(0, p.size()-1);
+}
+
+
+/**
+ * Calculates the shortest paths in the part p[first]..p[last] of p only,
+ * e.g. one of several contours stored one after the other.
+ */
+bool shortest_path::calculate(int first, int last)
 {
     // initialize start node
-    p[0].cost = 0;
-    p[0].pred = NIL;
-    p[0].in_deg = 0;
+    p[first].cost = 0;
+    p[first].pred = NIL;
+    p[first].in_deg = 0;
 
-    for (int j=1; j<(int)p.size(); j++)
+    for (int j=first+1; j<=last; j++)
     {
         int missed = 0;         // count successive missing edges
+        int depth_limit = limits ? limits->depth[j] : par.sp_depth_limit;
+        int missed_limit = limits ? limits->missed[j] : par.sp_missed_limit;
 
         // initialize node
         p[j].cost = INFINITY;
         p[j].pred = NIL;
         p[j].in_deg = 0;
+        COUNT(counts, nodes);
 
-        for (int i=j-1; i>=0; i--)
+        for (int i=j-1; i>=first; i--)
         {
             double c;
 
             // check edge (i,j)
 
-            if (i < j-par.sp_depth_limit)
+            if (i < j-depth_limit)
+            {
+                COUNT(counts, depth_breaks);
                 break;                  // again ?!
+            }
+
+            COUNT(counts, scanned);
 
             // calculate the cost of this edge
             if (cost(i, j, c) == false)
             {
                 // edge (i,j) does not exist
-                if (++missed >= par.sp_missed_limit)
+                COUNT(counts, infeasible);
+                if (++missed >= missed_limit)
+                {
+                    COUNT(counts, missed_breaks);
                     break;
+                }
             }
             else
             {
+                COUNT(counts, feasible);
                 missed = 0;
 
                 p[j].in_deg++;
@@ -68,21 +91,39 @@ bool shortest_path::calculate()
 }
 
 
-double shortest_path::extract(path& q) const
+/**
+ * Returns the indices of the nodes of the shortest path from the start
+ * node to p[last], see path_view.
+ *
+ * @return the cost of the path
+ */
+double shortest_path::extract(int last, vector<int>& index) const
 {
-    q.clear();
+    int n = 0;
+    for (int i=last; i!=NIL; i=p[i].pred)
+        n++;
 
-    int i = p.size()-1;
+    // filled backwards along the predecessors
+    index.resize(n);
+    for (int i=last; i!=NIL; i=p[i].pred)
+        index[--n] = i;
 
-    while (i != NIL)
-    {
-        q.push_back(p[i]);
-        i = p[i].pred;
-    }
+    return index.empty() ? 0 : p[index.back()].cost;
+}
 
-    double cost = q.empty() ? 0 : q[0].cost;
 
-    reverse(q.begin(), q.end());
+// indices of the shortest path to the last node
+double shortest_path::extract(vector<int>& index) const
+{
+    return extract(p.size()-1, index);
+}
+
 
+// copies the nodes of the shortest path into q, returns its cost
+double shortest_path::extract(path& q) const
+{
+    vector<int> index;
+    double cost = extract(index);
+    path_view(p, index).copy(q);
     return cost;
 }
@@ -4,6 +4,8 @@
 
 #include "parameter.h"
 #include "path.h"
+#include "counters.h"
+#include "adaptive.h"
 
 
 /**
@@ -22,18 +24,28 @@
  * cost(i,j) is calculated. If p[i].cost+cost(i,j)<p[j].cost then p[j].cost
  * is relaxed, the pointer p[j].back is set to p[i] and update(p[j]) is called.
  *
+ * With set_limits() the limits of a) and c) are taken per node j from
+ * search_limits instead of par.
  */
 class shortest_path
 {
 protected:
     const parameter& par;       // parameters
     path& p;                    // topological sort of the DAG
+    counters counts;            // see COUNT()
+    const search_limits* limits;    // per node limits or NULL
 
 public:
-    shortest_path(const parameter& par, path& p) : par(par), p(p) {}
+    shortest_path(const parameter& par, path& p) : par(par), p(p), limits(NULL) {}
+
+    void set_limits(const search_limits* l) { limits = l; }
 
     bool calculate();
+    bool calculate(int first, int last);
+    double extract(int last, vector<int>& index) const;
+    double extract(vector<int>& index) const;
     double extract(path& q) const;
+    const counters& get_counters() const { return counts; }
 
     virtual bool cost(int i, int j, double& c) = 0;
     virtual void update(int i) = 0;
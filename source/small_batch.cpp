@@ -0,0 +1,152 @@
+#include "small_batch.h"
+#include "sp_lines.h"
+#include "sp_bezier.h"
+#include "adaptive.h"
+#include "pipeline.h"
+#include "timer.h"
+#include "timeline.h"
+
+
+// adds a contour
+void small_batch::add(int id, const path& p)
+{
+    nodes.insert(nodes.end(), p.begin(), p.end());
+    first[0].push_back(nodes.size());
+
+    this->id.push_back(id);
+}
+
+
+// phase 1 of contour k, a view of its traced points
+path_view small_batch::lines1(int k) const
+{
+    return path_view(nodes.data(), lines.data()+first[1][k], first[1][k+1]-first[1][k]);
+}
+
+
+// phase 1 of contour k as indices of its traced points
+void small_batch::nodes1(int k, vector<int>& index) const
+{
+    index.assign(lines.begin()+first[1][k], lines.begin()+first[1][k+1]);
+    for (int i=0; i<(int)index.size(); i++)
+        index[i] -= first[0][k];
+}
+
+
+/**
+ * Runs the stages over all contours of the batch.
+ *
+ * @param par     parameters
+ * @param stages  1 = phase 1, 2 = intermediate points, 3 = phase 2
+ * @param times   time of every stage (ms, return)
+ */
+void small_batch::solve(const parameter& par, int stages, double* times)
+{
+    int n = size();
+
+    for (int s=1; s<4; s++)
+        first[s].assign(n+1, 0);
+    lines.clear();
+    middle.clear();
+    curves.clear();
+    cost1.assign(n, 0);
+    cost2.assign(n, 0);
+    times[0] = times[1] = times[2] = 0;
+
+    double c1 = time_ms();
+
+    if (stages >= 1)
+    {
+        search_limits lim;
+        sp_lines spl(par, nodes);
+        if (par.sp_adaptive)
+        {
+            // per contour, as in vectorize()
+            search_limits part;
+            for (int k=0; k<n; k++)
+            {
+                part.calculate(par, points(k));
+                lim.depth.insert(lim.depth.end(), part.depth.begin(), part.depth.end());
+                lim.missed.insert(lim.missed.end(), part.missed.begin(), part.missed.end());
+            }
+            spl.set_limits(&lim);
+        }
+
+        for (int k=0; k<n; k++)
+        {
+            int last = first[0][k+1]-1;
+            if (last > first[0][k])
+            {
+                spl.calculate(first[0][k], last);
+                cost1[k] = spl.extract(last, index);
+                lines.insert(lines.end(), index.begin(), index.end());
+            }
+            first[1][k+1] = lines.size();
+        }
+        k1.add(spl.get_counters());
+
+        double c2 = time_ms();
+        times[0] = c2 - c1;
+        timeline::record("phase1", c1, c2, "contours", n);
+        c1 = c2;
+    }
+
+    if (stages >= 2)
+    {
+        for (int k=0; k<n; k++)
+        {
+            add_intermediate_points(lines1(k), middle, par.b_corner_angle);
+            first[2][k+1] = middle.size();
+        }
+
+        double c2 = time_ms();
+        times[1] = c2 - c1;
+        timeline::record("middle", c1, c2, "contours", n);
+        c1 = c2;
+    }
+
+    if (stages >= 3)
+    {
+        sp_bezier spb(par, middle);
+        for (int k=0; k<n; k++)
+        {
+            int last = first[2][k+1]-1;
+            if (last > first[2][k])
+            {
+                spb.calculate(first[2][k], last);
+                cost2[k] = spb.extract(last, index);
+                for (int i=0; i<(int)index.size(); i++)
+                    curves.push_back(middle[index[i]]);
+            }
+            first[3][k+1] = curves.size();
+        }
+        k2.add(spb.get_counters());
+
+        // phase 2 marks curves in its path, the intermediate points are
+        // written and cached without
+        for (int i=0; i<(int)middle.size(); i++)
+            middle[i].flag &= ~BEZIER;
+
+        double c2 = time_ms();
+        times[2] = c2 - c1;
+        timeline::record("phase2", c1, c2, "contours", n);
+    }
+}
+
+
+// removes all contours, the buffers are kept
+void small_batch::clear()
+{
+    nodes.clear();
+    middle.clear();
+    curves.clear();
+    lines.clear();
+    for (int s=0; s<4; s++)
+        first[s].assign(1, 0);
+
+    id.clear();
+    cost1.clear();
+    cost2.clear();
+    k1.clear();
+    k2.clear();
+}
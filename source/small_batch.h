@@ -0,0 +1,60 @@
+#ifndef _SMALL_BATCH_H_
+#define _SMALL_BATCH_H_
+
+#include "parameter.h"
+#include "path.h"
+#include "counters.h"
+
+#define BATCH_NODES 4096    // traced points of a batch
+
+
+/**
+ * Small contours vectorized together (parameter sp_batch).
+ *
+ * Documents with many specks spend much of the time per contour outside
+ * the optimization: the paths of every stage, the solver objects, the
+ * timing and one SVG element per path and stage. A batch stores the
+ * traced points of many contours one after the other in one path. Phase 1
+ * runs over this path with one solver, contour by contour (see
+ * shortest_path::calculate(first, last)), and keeps its result as indices.
+ * The intermediate points and phase 2 work the same way on a second path.
+ * The buffers are kept from batch to batch.
+ */
+class small_batch
+{
+private:
+    path nodes;             // traced points
+    path middle;            // intermediate points (phase 2 solves in it)
+    path curves;            // phase 2 results, copied from middle
+    vector<int> lines;      // phase 1 results as indices into nodes
+    vector<int> first[4];   // start of contour k in nodes, lines, middle, curves
+    vector<int> index;
+
+public:
+    vector<int>    id;      // contour ids
+    vector<double> cost1, cost2;
+    counters k1, k2;        // summed over the batch
+
+    small_batch() { clear(); }
+
+    int  size() const { return id.size(); }
+    bool full() const { return nodes.size() >= BATCH_NODES; }
+
+    void add(int id, const path& p);
+    void solve(const parameter& par, int stages, double* times);
+    void clear();
+
+    path_view points(int k) const { return part(nodes, 0, k); }
+    path_view lines1(int k) const;
+    void nodes1(int k, vector<int>& index) const;
+    path_view lines2(int k) const { return part(middle, 2, k); }
+    path_view result(int k) const { return part(curves, 3, k); }
+
+private:
+    path_view part(const path& p, int stage, int k) const
+    {
+        return path_view(p.data()+first[stage][k], first[stage][k+1]-first[stage][k]);
+    }
+};
+
+#endif
@@ -9,10 +9,18 @@
 
 
 // insert intermediate points and set flags (CORNER, MIDDLE)
-bool intermediate_points(const path& p, path& q, double corner_angle)
+bool intermediate_points(const path_view& p, path& q, double corner_angle)
 {
     q.clear();
 
+    return add_intermediate_points(p, q, corner_angle);
+}
+
+
+// intermediate_points() appended to q, e.g. for several contours in one path
+bool add_intermediate_points(const path_view& p, path& q, double corner_angle)
+{
+    int start = q.size();
     int last = p.size()-1;
 
     // p must have at least 2 points
@@ -31,7 +39,7 @@ bool intermediate_points(const path& p, path& q, double corner_angle)
     double len2 = m2.len();
     double pos = 0;
     
-    for (int i=1; i<(int)p.size(); i++)
+    for (int i=1; i<p.size(); i++)
     {
         point m1   = m2;
         double len1 = len2;
@@ -69,7 +77,7 @@ bool intermediate_points(const path& p, path& q, double corner_angle)
         }
     }
 
-    q.push_back(node(q[0], MIDDLE, pos+q[0].pos));
+    q.push_back(node(q[start], MIDDLE, pos+q[start].pos));
 
     return true;
 }
@@ -131,6 +139,7 @@ bool sp_bezier::fit_bezier(int i, int j, double& area, point* xy)
     assert(i+1<j);  // at least one intermediate point
 
     area = (double)1e20;
+    COUNT(counts, fit_calls);
 
     b[0] = p[i];
     b[3] = p[j];
@@ -141,7 +150,10 @@ bool sp_bezier::fit_bezier(int i, int j, double& area, point* xy)
     // constraint: angle(m1,seg)<=90° and angle(m2,-seg)<=90°
     point seg = p[j]-p[i];
     if (dot(m1, seg)<0 || dot(m2, seg)>0)
+    {
+        COUNT(counts, fit_tangents);
         return false;
+    }
 
     // squared limit for distance of control points
     double max_len2 = p[j].pos - p[i].pos;
@@ -156,6 +168,7 @@ bool sp_bezier::fit_bezier(int i, int j, double& area, point* xy)
     for (int k=i+(j-i+1-cnt)/2; cnt--; k++)
     {
         assert(k>i && k<j);
+        COUNT(counts, fit_tried);
 
         // the line pt+r*mt shall be the tangent of the curve at b(t=0.5)
         point pt = p[k]*(2/3.0F)+p[k+1]*(1/3.0F);
@@ -174,32 +187,46 @@ bool sp_bezier::fit_bezier(int i, int j, double& area, point* xy)
         
         // calculate control points
         if (calc_b12(b, m1, m2, pt, mt)==false)
+        {
+            COUNT(counts, fit_singular);
             continue;
+        }
 
         point bm1 = b[1]-b[0];
         point bm2 = b[2]-b[3];
 
         // constraint: direction of control points ok?
         if (dot(bm1,m1)<0 || dot(bm2,m2)<0)
+        {
+            COUNT(counts, fit_direction);
             continue;
+        }
 
         // constraint: distance of control points within limit?
         double len2 = bm1.len2();
-        if (len2>max_len2 || len2<min_len2)
-            continue;
-        len2 = bm2.len2();
-        if (len2>max_len2 || len2<min_len2)
+        double len2b = bm2.len2();
+        if (len2>max_len2 || len2<min_len2 || len2b>max_len2 || len2b<min_len2)
+        {
+            COUNT(counts, fit_length);
             continue;
+        }
         //if (bm1.len2()>max_len2 || bm2.len2()>max_len2)
         //    continue;
 
-        point bp[16+1];
-        bezier_points(b, bp, 16);
+        // the points of the curve in double also with float coordinates:
+        // calc_area() depends on points that lie exactly on the polyline
+        vertex bd[4] = { vertex(b[0]), vertex(b[1]), vertex(b[2]), vertex(b[3]) };
+        vertex bp[16+1];
+        bezier_points(bd, bp, 16);
 
         double a;
         // constraint: maximal distance of curve to polyline ok?
+        COUNT(counts, calc_area);
         if (calc_area(&p[i], j-i+1, bp, 17, par.b_max_distance, a)==false)
+        {
+            COUNT(counts, fit_distance);
             continue;
+        }
 
         // is better?
         if (a < area)
@@ -234,6 +261,7 @@ bool sp_bezier::cost(int i, int j, double& cost)
     }
 
     assert(not_middle>0);
+    COUNT(counts, cost);
 
     // try to fit a curve only, if start and end points are CORNER or MIDDLE
     if ((p[i].flag&(CORNER|MIDDLE)) && (p[j].flag&(CORNER|MIDDLE)))
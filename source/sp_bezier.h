@@ -22,6 +22,7 @@ public:
 };
 
 
-bool intermediate_points(const path& p, path& q, double corner_angle);
+bool intermediate_points(const path_view& p, path& q, double corner_angle);
+bool add_intermediate_points(const path_view& p, path& q, double corner_angle);
 
 #endif
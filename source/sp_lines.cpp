@@ -7,13 +7,15 @@
 bool sp_lines::cost(int i, int j, double& cost)
 {
     assert(i<j);
+    COUNT(counts, cost);
 
-    point& p1 = p[i];
-    point& p2 = p[j];
-    point p21 = p2 - p1;
+    // in double also with float coordinates, converted once per point
+    vertex p1(p[i]);
+    vertex p2(p[j]);
+    vertex p21 = p2 - p1;
     
     // normal vector, perpendicular to segment (p1,p2)
-    point n = perp(p21);
+    vertex n = perp(p21);
 
     // len = length(n)
     double len = n.len();
@@ -30,7 +32,7 @@ bool sp_lines::cost(int i, int j, double& cost)
     // loop through the intermediate points of the contour
     for (int k=i+1; k<j; k++)
     {
-        point pk1 = p[k] - p1;
+        vertex pk1 = vertex(p[k]) - p1;
 
         // d = dist(p[k],segment) * length(n)
         double d = dot(n, pk1);
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "spatial_index.h"
+
+
+// adds the points and control points of p
+void bounds::add(const path_view& p)
+{
+    for (int i=0; i<p.size(); i++)
+    {
+        add(p[i]);
+        if (p[i].flag & BEZIER)
+        {
+            add(p[i].xy[0]);
+            add(p[i].xy[1]);
+        }
+    }
+}
+
+
+// position of (x,y) on the Hilbert curve through 2^16 x 2^16 cells
+static uint32_t hilbert(uint32_t x, uint32_t y)
+{
+    const uint32_t n = 1 << 16;
+    uint32_t d = 0;
+
+    for (uint32_t s=n/2; s>0; s/=2)
+    {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+
+        // rotate the quadrant
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = n-1 - x;
+                y = n-1 - y;
+            }
+            swap(x, y);
+        }
+    }
+
+    return d;
+}
+
+
+/**
+ * Records an element of the output.
+ *
+ * @param id     contour id, -1 = several contours
+ * @param b      bounding box
+ * @param start  first byte of the element in the output (svg::tell())
+ * @param end    end of the element
+ */
+void spatial_index::add(int id, const bounds& b, long long start, long long end)
+{
+    if (b.empty() || end <= start)
+        return;
+
+    item e;
+    e.x0 = (float)b.x0;
+    e.y0 = (float)b.y0;
+    e.x1 = (float)b.x1;
+    e.y1 = (float)b.y1;
+    e.offset = start;
+    e.length = (uint32_t)(end - start);
+    e.id = id;
+    e.hilbert = 0;
+    items.push_back(e);
+}
+
+
+// sorts the elements, packs the tree and writes the index file
+bool spatial_index::save(const char* filename)
+{
+    int n = items.size();
+
+    // order along the Hilbert curve through the centers
+    bounds all;
+    for (int i=0; i<n; i++)
+    {
+        all.add(point(items[i].x0, items[i].y0));
+        all.add(point(items[i].x1, items[i].y1));
+    }
+    double w = max(all.x1 - all.x0, 1e-9);
+    double h = max(all.y1 - all.y0, 1e-9);
+    for (int i=0; i<n; i++)
+    {
+        const item& e = items[i];
+        double x = ((e.x0 + e.x1)/2 - all.x0) / w;
+        double y = ((e.y0 + e.y1)/2 - all.y0) / h;
+        items[i].hilbert = hilbert((uint32_t)(x*65535), (uint32_t)(y*65535));
+    }
+    stable_sort(items.begin(), items.end(),
+        [](const item& a, const item& b) { return a.hilbert < b.hilbert; });
+
+    // the levels bottom up, every node covers INDEX_NODE_SIZE boxes of the level below
+    vector<float> box;
+    vector<uint32_t> end;
+    for (int i=0; i<n; i++)
+    {
+        const item& e = items[i];
+        float b[4] = { e.x0, e.y0, e.x1, e.y1 };
+        box.insert(box.end(), b, b+4);
+    }
+    if (n > 0)
+        end.push_back(n);
+
+    uint32_t first = 0;
+    while (!end.empty() && end.back() - first > 1)
+    {
+        uint32_t last = end.back();
+        for (uint32_t j=first; j<last; j+=INDEX_NODE_SIZE)
+        {
+            float b[4] = { box[4*j], box[4*j+1], box[4*j+2], box[4*j+3] };
+            for (uint32_t k=j+1; k<min(j+INDEX_NODE_SIZE, last); k++)
+            {
+                b[0] = min(b[0], box[4*k]);
+                b[1] = min(b[1], box[4*k+1]);
+                b[2] = max(b[2], box[4*k+2]);
+                b[3] = max(b[3], box[4*k+3]);
+            }
+            box.insert(box.end(), b, b+4);
+        }
+        first = last;
+        end.push_back(box.size()/4);
+    }
+
+    FILE* f = fopen(filename, "wb");
+    if (f==NULL)
+        return false;
+
+    uint32_t header[4] = { 1, INDEX_NODE_SIZE, (uint32_t)n, (uint32_t)end.size() };
+    bool ok = fwrite("spvecidx", 1, 8, f)==8 &&
+              fwrite(header, sizeof(header), 1, f)==1 &&
+              fwrite(end.data(), sizeof(uint32_t), end.size(), f)==end.size() &&
+              fwrite(box.data(), sizeof(float), box.size(), f)==box.size();
+
+    for (int i=0; i<n && ok; i++)
+    {
+        const item& e = items[i];
+        char b[16];
+        memcpy(b, &e.offset, 8);
+        memcpy(b+8, &e.length, 4);
+        memcpy(b+12, &e.id, 4);
+        ok = fwrite(b, 1, sizeof(b), f)==sizeof(b);
+    }
+
+    return fclose(f)==0 && ok;
+}
@@ -0,0 +1,87 @@
+#ifndef _SPATIAL_INDEX_H_
+#define _SPATIAL_INDEX_H_
+
+#include <stdint.h>
+#include <vector>
+using namespace std;
+
+#include "path.h"
+
+#define INDEX_NODE_SIZE 16  // children of an inner node
+
+
+// bounding box, empty if x0 > x1
+class bounds
+{
+public:
+    double x0, y0, x1, y1;
+
+    bounds() : x0(1e300), y0(1e300), x1(-1e300), y1(-1e300) {}
+
+    bool empty() const { return x0 > x1; }
+
+    void add(point p)
+    {
+        if (p.x < x0) x0 = p.x;
+        if (p.y < y0) y0 = p.y;
+        if (p.x > x1) x1 = p.x;
+        if (p.y > y1) y1 = p.y;
+    }
+
+    void add(const bounds& b)
+    {
+        if (b.empty())
+            return;
+        add(point(b.x0, b.y0));
+        add(point(b.x1, b.y1));
+    }
+
+    void add(const path_view& p);
+};
+
+
+/**
+ * Spatial index of the elements of an SVG file (parameter svg_index), so
+ * that a viewer reads only the byte ranges of the visible contours. The
+ * output records the bounding box and the byte range of every contour
+ * (a batch, a filled path) while it writes them; save() sorts them along
+ * a Hilbert curve and packs an R-tree over them bottom up with
+ * INDEX_NODE_SIZE children per node. The file (little-endian):
+ *
+ *   char     magic[8]          "spvecidx"
+ *   uint32   version           1
+ *   uint32   node_size         children of an inner node
+ *   uint32   items             indexed elements
+ *   uint32   levels            levels of the tree, 0 = leaves (the items)
+ *   uint32   end[levels]       end of every level in the boxes
+ *   float    box[end[levels-1]][4]   x0 y0 x1 y1: items, inner nodes, root last
+ *   item     item[items]       uint64 offset, uint32 length, int32 id
+ *
+ * The children of box j of level l > 0 are the node_size boxes from
+ * end[l-2] + (j-end[l-1])*node_size on (end[-1] = 0), at most up to
+ * end[l-1]. id is the contour id or -1 for a batch.
+ */
+class spatial_index
+{
+private:
+    class item
+    {
+    public:
+        float x0, y0, x1, y1;
+        uint64_t offset;
+        uint32_t length;
+        int32_t id;
+        uint32_t hilbert;
+    };
+
+    vector<item> items;
+
+public:
+    void clear() { items.clear(); }
+    int  size() const { return items.size(); }
+
+    void add(int id, const bounds& b, long long start, long long end);
+    bool save(const char* filename);
+};
+
+#endif
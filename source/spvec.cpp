@@ -0,0 +1,219 @@
+#include "spvec.h"
+#include "spvec_c.h"
+#include "bitmap.h"
+#include "timer.h"
+#include "timeline.h"
+
+
+// vectorize the bitmap and write a complete SVG document to the sink
+static int vectorize_map(const parameter& par, const bitmap& map,
+                         svg_sink sink, void* ctx, spvec_result* result)
+{
+    svg s;
+    if (sink!=NULL)
+    {
+        s.open(sink, ctx);
+        s.write_header(map.get_width(), map.get_height());
+    }
+
+    statistics st;
+    vector<path>    paths;
+    vector<contour> contours;
+
+    vectorize(par, map, sink!=NULL ? &s : NULL, st,
+              result!=NULL ? &paths : NULL, result!=NULL ? &contours : NULL);
+
+    if (result!=NULL)
+    {
+        result->width = map.get_width();
+        result->height = map.get_height();
+        result->paths.swap(paths);
+        result->contours.swap(contours);
+        result->st = st;
+    }
+
+    if (sink!=NULL)
+    {
+        s.write_end();
+        if (!s.close())
+            return -5;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Vectorizes a bitmap given as packed rows of 1 bit per pixel.
+ *
+ * @param par     parameters
+ * @param bits    the first row (most significant bit first, set = foreground, see tracer)
+ * @param w       width
+ * @param h       height
+ * @param stride  bytes from one row to the next
+ * @param sink    receives the SVG document, NULL = none
+ * @param ctx     passed to the sink
+ * @param result  paths and statistics or NULL (return)
+ *
+ * @return 0=OK, -2=no memory, -5=sink failed, -6=bad size
+ */
+int spvec_vectorize(const parameter& par, const unsigned char* bits, int w, int h, int stride,
+                    svg_sink sink, void* ctx, spvec_result* result)
+{
+    if (w<=0 || h<=0 || w>BITMAP_MAX_SIDE || h>BITMAP_MAX_SIDE || stride<(w+7)/8)
+        return -6;
+
+    bitmap map;
+    if (!map.init_from_memory(bits, w, h, stride))
+        return -2;
+
+    return vectorize_map(par, map, sink, ctx, result);
+}
+
+
+/**
+ * Vectorizes the content of a PNG file of 1 bit depth.
+ *
+ * @return 0=OK, -2..-4 see bitmap::init_from_png_data(), -5=sink failed
+ */
+int spvec_vectorize(const parameter& par, const void* data, size_t size,
+                    svg_sink sink, void* ctx, spvec_result* result)
+{
+    double c0 = time_ms();
+
+    bitmap map;
+    int ret = map.init_from_png_data(data, size);
+    if (ret!=0)
+        return ret;
+
+    timeline::record("decode", c0, time_ms(), "pixels", (long)map.get_width()*map.get_height());
+
+    return vectorize_map(par, map, sink, ctx, result);
+}
+
+
+// C interface
+
+struct spvec_parameter
+{
+    parameter par;
+};
+
+
+spvec_parameter* spvec_parameter_new(void)
+{
+    return new spvec_parameter;
+}
+
+
+int spvec_parameter_set(spvec_parameter* par, const char* str)
+{
+    return par->par.parse(str);
+}
+
+
+int spvec_parameter_load(spvec_parameter* par, const char* filename)
+{
+    return par->par.load(filename);
+}
+
+
+void spvec_parameter_free(spvec_parameter* par)
+{
+    delete par;
+}
+
+
+int spvec_vectorize_bitmap(const spvec_parameter* par, const unsigned char* bits, int w, int h, int stride,
+                           spvec_sink sink, void* ctx, spvec_result** result)
+{
+    spvec_result* r = result!=NULL ? new spvec_result : NULL;
+
+    int ret = spvec_vectorize(par->par, bits, w, h, stride, sink, ctx, r);
+
+    if (result!=NULL)
+    {
+        if (ret!=0)
+        {
+            delete r;
+            r = NULL;
+        }
+        *result = r;
+    }
+
+    return ret;
+}
+
+
+int spvec_vectorize_png(const spvec_parameter* par, const void* data, size_t size,
+                        spvec_sink sink, void* ctx, spvec_result** result)
+{
+    spvec_result* r = result!=NULL ? new spvec_result : NULL;
+
+    int ret = spvec_vectorize(par->par, data, size, sink, ctx, r);
+
+    if (result!=NULL)
+    {
+        if (ret!=0)
+        {
+            delete r;
+            r = NULL;
+        }
+        *result = r;
+    }
+
+    return ret;
+}
+
+
+int spvec_result_count(const spvec_result* r)
+{
+    return r->paths.size();
+}
+
+
+int spvec_result_segments(const spvec_result* r, int i)
+{
+    return r->paths[i].size();
+}
+
+
+void spvec_result_segment(const spvec_result* r, int i, int j, spvec_segment* s)
+{
+    const node& n = r->paths[i][j];
+
+    s->x = n.x;
+    s->y = n.y;
+    s->curve = j>0 && (n.flag & BEZIER) ? 1 : 0;
+
+    if (s->curve)
+    {
+        s->x1 = n.xy[0].x;
+        s->y1 = n.xy[0].y;
+        s->x2 = n.xy[1].x;
+        s->y2 = n.xy[1].y;
+    }
+    else
+    {
+        s->x1 = s->x2 = n.x;
+        s->y1 = s->y2 = n.y;
+    }
+}
+
+
+int spvec_result_parent(const spvec_result* r, int i)
+{
+    return r->contours[i].parent;
+}
+
+
+int spvec_result_hole(const spvec_result* r, int i)
+{
+    return r->contours[i].hole;
+}
+
+
+void spvec_result_free(spvec_result* r)
+{
+    delete r;
+}
@@ -0,0 +1,34 @@
+#ifndef _SPVEC_H_
+#define _SPVEC_H_
+
+// C++ interface of the library libspvec (see spvec_c.h for C)
+//
+// All functions are re-entrant: any number of threads may vectorize
+// images at the same time, each with its own parameters and result.
+
+#include "parameter.h"
+#include "path.h"
+#include "tracer.h"
+#include "svg.h"
+#include "pipeline.h"
+
+
+// result of a vectorized image
+class spvec_result
+{
+public:
+    int width, height;
+    vector<path>    paths;      // final path of every contour
+    vector<contour> contours;   // nesting information of every contour
+    statistics      st;
+
+    spvec_result() : width(0), height(0) {}
+};
+
+
+int spvec_vectorize(const parameter& par, const unsigned char* bits, int w, int h, int stride,
+                    svg_sink sink, void* ctx, spvec_result* result);
+int spvec_vectorize(const parameter& par, const void* data, size_t size,
+                    svg_sink sink, void* ctx, spvec_result* result);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _SPVEC_C_H_
+#define _SPVEC_C_H_
+
+/*
+ * C interface of the library libspvec
+ *
+ * Bitmaps are passed as packed rows of 1 bit per pixel (most significant
+ * bit first, set bits are foreground, a set background is the image frame
+ * and is not traced) or as the content of a PNG file of 1 bit depth. The
+ * SVG document is passed to a sink function, the paths are returned as
+ * spvec_result. Both are optional.
+ *
+ * All functions are re-entrant, objects must not be shared between
+ * threads without locking.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct spvec_parameter spvec_parameter;
+typedef struct spvec_result    spvec_result;
+
+/* receives the output (like fwrite()), returns the number of bytes written */
+typedef size_t (*spvec_sink)(void* ctx, const char* data, size_t len);
+
+/* segment of a path ending at (x,y); x1,y1,x2,y2 are the control points of a curve */
+typedef struct spvec_segment
+{
+    double x, y;
+    double x1, y1, x2, y2;
+    int    curve;
+} spvec_segment;
+
+/* parameters with default values, set() takes "name=value", 0 = unknown */
+spvec_parameter* spvec_parameter_new(void);
+int  spvec_parameter_set(spvec_parameter* par, const char* str);
+int  spvec_parameter_load(spvec_parameter* par, const char* filename);
+void spvec_parameter_free(spvec_parameter* par);
+
+/*
+ * Vectorizes a bitmap. sink and result may be NULL.
+ * Returns 0=OK, -2=no memory, -3=PNG error, -4=wrong depth, -5=sink failed,
+ * -6=bad size (width or height <1 or >2^20, stride < (width+7)/8)
+ */
+int spvec_vectorize_bitmap(const spvec_parameter* par, const unsigned char* bits, int w, int h, int stride,
+                           spvec_sink sink, void* ctx, spvec_result** result);
+int spvec_vectorize_png(const spvec_parameter* par, const void* data, size_t size,
+                        spvec_sink sink, void* ctx, spvec_result** result);
+
+/* contours of the result; the first point of a path is segment 0 */
+int  spvec_result_count(const spvec_result* r);
+int  spvec_result_segments(const spvec_result* r, int i);
+void spvec_result_segment(const spvec_result* r, int i, int j, spvec_segment* s);
+int  spvec_result_parent(const spvec_result* r, int i);
+int  spvec_result_hole(const spvec_result* r, int i);
+void spvec_result_free(spvec_result* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,42 +1,224 @@
 #include <assert.h>
+#include <stdarg.h>
+#include <string.h>
+#include <algorithm>
 
 #include "svg.h"
 
 
+static size_t file_sink(void* ctx, const char* data, size_t len)
+{
+    return fwrite(data, 1, len, (FILE*)ctx);
+}
+
+
 bool svg::open(const char* filename)
 {
-    if (f!=NULL)
-        fclose(f);
+    close();
 
-    f = fopen(filename, "w");
-    
-    return f!=NULL;
+    FILE* file = fopen(filename, "w");
+    if (file==NULL)
+        return false;
+
+    open(file_sink, file);
+    f = file;
+
+    return true;
+}
+
+
+// write the output to a sink
+bool svg::open(svg_sink sink, void* ctx)
+{
+    close();
+
+    this->sink = sink;
+    this->ctx = ctx;
+    buf = new char[SVG_BUFFER];
+    pos = 0;
+    flushed = 0;
+    error = false;
+
+    return true;
 }
 
 
 bool svg::close()
 {
-    if (f==NULL)
+    if (sink==NULL)
         return false;
-    
-    int ret = fclose(f);
+
+    flush();
+
+    if (io!=NULL)
+    {
+        {
+            lock_guard<mutex> guard(io_lock);
+            io_done = true;
+            io_changed.notify_all();
+        }
+        io->join();
+        delete io;
+        io = NULL;
+        io_done = false;
+
+        for (int i=0; i<(int)spare.size(); i++)
+            delete[] spare[i];
+        spare.clear();
+        buffers = 0;
+    }
+
+    sink = NULL;
+
+    delete[] buf;
+    buf = NULL;
+
+    if (f!=NULL && fclose(f)!=0)
+        error = true;
     f = NULL;
 
-    return ret==0;
+    return !error;
+}
+
+
+/**
+ * From now on full buffers are passed to the sink by a thread, in order.
+ * The output only waits if SVG_BUFFERS buffers are pending, so slow writes
+ * (network file systems) overlap with the calculation. close() waits for
+ * the thread.
+ */
+void svg::set_async()
+{
+    if (sink==NULL || io!=NULL)
+        return;
+
+    buffers = 1;
+    io = new thread(&svg::io_run, this);
+}
+
+
+// thread of the asynchronous output
+void svg::io_run()
+{
+    unique_lock<mutex> guard(io_lock);
+
+    for (;;)
+    {
+        while (pending.empty() && !io_done)
+            io_changed.wait(guard);
+        if (pending.empty())
+            return;
+
+        pair<char*,int> b = pending.front();
+        guard.unlock();
+        bool ok = sink(ctx, b.first, b.second)==(size_t)b.second;
+        guard.lock();
+
+        pending.pop_front();
+        spare.push_back(b.first);
+        if (!ok)
+            error = true;
+        io_changed.notify_all();
+    }
+}
+
+
+// pass the buffered output to the sink
+void svg::flush()
+{
+    if (pos > 0 && io!=NULL)
+    {
+        unique_lock<mutex> guard(io_lock);
+        pending.push_back(make_pair(buf, pos));
+        io_changed.notify_all();
+
+        if (spare.empty() && buffers < SVG_BUFFERS)
+        {
+            buffers++;
+            buf = new char[SVG_BUFFER];
+        }
+        else
+        {
+            while (spare.empty())
+                io_changed.wait(guard);
+            buf = spare.back();
+            spare.pop_back();
+        }
+    }
+    else if (pos > 0 && sink(ctx, buf, pos)!=(size_t)pos)
+        error = true;
+    flushed += pos;
+    pos = 0;
+}
+
+
+/**
+ * Records the output from start (see tell()) up to here in the spatial
+ * index, as contour id (-1 = several contours) with bounding box b.
+ */
+void svg::add_item(int id, const bounds& b, long long start)
+{
+    if (index!=NULL)
+        index->add(id, b, start, tell());
+}
+
+
+// unformatted output through the buffer
+void svg::put(const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        size_t n = min((size_t)(SVG_BUFFER-pos), len);
+        memcpy(buf+pos, data, n);
+        pos += n;
+        data += n;
+        len -= n;
+        if (pos == SVG_BUFFER)
+            flush();
+    }
+}
+
+
+// formatted output into the buffer
+void svg::print(const char* format, ...)
+{
+    if (sink==NULL)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf+pos, SVG_BUFFER-pos, format, args);
+    va_end(args);
+
+    if (len < SVG_BUFFER-pos)
+    {
+        pos += len;
+        return;
+    }
+
+    // does not fit into the buffer
+    flush();
+
+    vector<char> help(len+1);
+    va_start(args, format);
+    vsnprintf(&help[0], len+1, format, args);
+    va_end(args);
+
+    put(&help[0], len);
 }
 
 
 void svg::write_header(int w, int h)
 {
-    if (f==NULL)
+    if (sink==NULL)
         return;
     
-    fprintf(f, "<?xml version=\"1.0\" standalone=\"yes\"?>\n");
-    fprintf(f, "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"%d\" height=\"%d\">\n", w, h);
-    fprintf(f, "<g id=\"all\">\n");
+    print("<?xml version=\"1.0\" standalone=\"yes\"?>\n");
+    print("<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"%d\" height=\"%d\">\n", w, h);
+    print("<g id=\"all\">\n");
 
     // marker definition
-    fprintf(f,
+    print(
         "<defs>\n"
 
         "<marker id=\"blue\" "
@@ -66,10 +248,10 @@ void svg::write_header(int w, int h)
 
 void svg::write_image(int w, int h, const char* filename)
 {
-    if (f==NULL)
+    if (sink==NULL)
         return;
     
-    fprintf(f,
+    print(
         "<image x=\"0\" y=\"0\" width=\"%d\" height=\"%d\" xlink:href=\"%s\" "
         "style=\"image-rendering: crisp-edges;\" />\n", w, h, filename);
 }
@@ -77,51 +259,66 @@ void svg::write_image(int w, int h, const char* filename)
 
 void svg::write_bezier(point* b, const char* color)
 {
-    fprintf(f, "<path style=\"fill:none; stroke:%s; stroke-width:0.05\" ", color);
+    print("<path style=\"fill:none; stroke:%s; stroke-width:0.05\" ", color);
 
-    fprintf(f, "d=\"M%.1f %.1f C%.1f %.1f %.1f %.1f %.1f %.1f\" />\n",
+    print("d=\"M%.1f %.1f C%.1f %.1f %.1f %.1f %.1f %.1f\" />\n",
         b[0].x, b[0].y, b[1].x, b[1].y, b[2].x, b[2].y, b[3].x, b[3].y);
 }
 
 
-void svg::write_path(const path& p, const char* color, double stroke_width, int flags)
+// write the path data (the content of the d attribute) of p
+void svg::write_data(const path_view& p, int flags)
 {
-    if (f==NULL || p.empty())
-        return;
-    
-    if (flags&SVG_FILL)
-        fprintf(f, "<path style=\"fill:%s; stroke:none\" ", color);
-    else
-        fprintf(f, "<path style=\"fill:none; stroke:%s; stroke-width:%.1f\" ", color, stroke_width);
-
-    if (flags&SVG_MARKER)
-        fprintf(f, "marker-mid=\"url(#%s)\" marker-start=\"url(#%s)\" marker-end=\"url(#%s)\" ",
-        color, color, color);
-
-    fprintf(f, "d=\"M%.1f %.1f ", p[0].x, p[0].y);
+    print("M%.1f %.1f ", p[0].x, p[0].y);
 
-    for (path::const_iterator pi=p.begin(); ++pi!=p.end(); )
+    for (int i=1; i<p.size(); i++)
     {
+        const node* pi = &p[i];
         if ((pi->flag&BEZIER) && (flags&SVG_CURVES))
-            fprintf(f, "C%.1f %.1f %.1f %.1f %.1f %.1f ",
+            print("C%.1f %.1f %.1f %.1f %.1f %.1f ",
             pi->xy[0].x, pi->xy[0].y, pi->xy[1].x, pi->xy[1].y, pi->x, pi->y);
         else if ((pi->flag&BEZIER)==0 && (flags&SVG_LINES))
-            fprintf(f, "L%.1f %.1f ", pi->x, pi->y);
+            print("L%.1f %.1f ", pi->x, pi->y);
         else
-            fprintf(f, "M%.1f %.1f ", pi->x, pi->y);
+            print("M%.1f %.1f ", pi->x, pi->y);
     }
+}
+
+
+// write the start of a path element up to its d attribute
+void svg::write_style(const char* color, double stroke_width, int flags)
+{
+    if (flags&SVG_FILL)
+        print("<path style=\"fill:%s; stroke:none\" ", color);
+    else
+        print("<path style=\"fill:none; stroke:%s; stroke-width:%.1f\" ", color, stroke_width);
+
+    if (flags&SVG_MARKER)
+        print("marker-mid=\"url(#%s)\" marker-start=\"url(#%s)\" marker-end=\"url(#%s)\" ",
+        color, color, color);
+
+    print("d=\"");
+}
 
-    fprintf(f, "\" />\n");
+
+void svg::write_path(const path_view& p, const char* color, double stroke_width, int flags)
+{
+    if (sink==NULL || p.empty())
+        return;
+    
+    write_style(color, stroke_width, flags);
+    write_data(p, flags);
+    print("\" />\n");
 
     if (flags&SVG_TEXT)
     {
         int i;
         int b_cnt=0;
-        for (i=1; i<(int)p.size(); i++)
+        for (i=1; i<p.size(); i++)
         {
-            //fprintf(f, "<text x=\"%.1f\" y=\"%.1f\" font-size=\"2\">%.1f (%d,%d)</text>\n",
+            //print("<text x=\"%.1f\" y=\"%.1f\" font-size=\"2\">%.1f (%d,%d)</text>\n",
             //p[i].x+1, p[i].y, p[i].cost - p[i-1].cost, p[i].in_deg, p[i].flag);
-            fprintf(f, "<text x=\"%.1f\" y=\"%.1f\" font-size=\"1.5\">%.1f</text>\n",
+            print("<text x=\"%.1f\" y=\"%.1f\" font-size=\"1.5\">%.1f</text>\n",
             p[i].x+0.4, p[i].y-0.7, p[i].cost - p[i-1].cost);
 
             if (p[i].flag&BEZIER)
@@ -130,44 +327,115 @@ void svg::write_path(const path& p, const char* color, double stroke_width, int
 
         i--;
         
-        fprintf(f, "<text x=\"%.1f\" y=\"%.1f\" font-size=\"3\">%.1f #%d,%d</text>\n",
-            p[i].x, p[i].y-4, p[i].cost, b_cnt, (int)p.size()-1-b_cnt);
+        print("<text x=\"%.1f\" y=\"%.1f\" font-size=\"3\">%.1f #%d,%d</text>\n",
+            p[i].x, p[i].y-4, p[i].cost, b_cnt, p.size()-1-b_cnt);
         
     }
 }
 
 
-void svg::write_control_points(const path& p)
+/**
+ * Writes several paths as the subpaths of one path element, e.g. the
+ * contours of a batch (sp_batch). With markers, every point gets
+ * the same marker as with write_path().
+ */
+void svg::write_paths(const vector<path_view>& parts, const char* color, double stroke_width, int flags)
 {
-    if (f==NULL || p.empty())
+    int n = 0;
+    for (int i=0; i<(int)parts.size(); i++)
+        n += parts[i].size();
+    if (sink==NULL || n==0)
+        return;
+
+    write_style(color, stroke_width, flags);
+
+    for (int i=0; i<(int)parts.size(); i++)
+        if (!parts[i].empty())
+            write_data(parts[i], flags);
+
+    print("\" />\n");
+}
+
+
+/**
+ * Writes closed paths as one filled path with the even-odd rule,
+ * e.g. an outer contour followed by its holes.
+ */
+void svg::write_compound(const vector<const path*>& parts, const char* color, int flags)
+{
+    if (sink==NULL || parts.empty())
         return;
-    
-    fprintf(f,
-        "<g style=\"fill:none; stroke:green; stroke-width:0.05; stroke-dasharray:0.5,0.5\" "
-        "marker-end=\"url(#control)\">\n");
 
-    for (int i=1; i<(int)p.size(); i++)
+    print("<path style=\"fill:%s; fill-rule:evenodd; stroke:none\" d=\"", color);
+
+    for (int i=0; i<(int)parts.size(); i++)
+    {
+        if (parts[i]->empty())
+            continue;
+
+        write_data(*parts[i], flags);
+        print("Z ");
+    }
+
+    print("\" />\n");
+}
+
+
+// write the lines to the control points of p
+void svg::write_control_data(const path_view& p)
+{
+    for (int i=1; i<p.size(); i++)
     {
         const point* xy = p[i].xy;
         if (p[i].flag&BEZIER)
         {
-            fprintf(f, "<path d=\"M%.1f %.1f L%.1f %.1f\" />\n", p[i-1].x, p[i-1].y, xy[0].x, xy[0].y);
-            fprintf(f, "<path d=\"M%.1f %.1f L%.1f %.1f\" />\n", p[i].x, p[i].y, xy[1].x, xy[1].y);
+            print("<path d=\"M%.1f %.1f L%.1f %.1f\" />\n", p[i-1].x, p[i-1].y, xy[0].x, xy[0].y);
+            print("<path d=\"M%.1f %.1f L%.1f %.1f\" />\n", p[i].x, p[i].y, xy[1].x, xy[1].y);
         }
     }
+}
+
+
+void svg::write_control_points(const path& p)
+{
+    if (sink==NULL || p.empty())
+        return;
+    
+    print(
+        "<g style=\"fill:none; stroke:green; stroke-width:0.05; stroke-dasharray:0.5,0.5\" "
+        "marker-end=\"url(#control)\">\n");
 
-    fprintf(f, "</g>\n");
+    write_control_data(p);
+
+    print("</g>\n");
+}
+
+
+// the control points of several paths in one group
+void svg::write_control_points(const vector<path_view>& parts)
+{
+    if (sink==NULL || parts.empty())
+        return;
+
+    print(
+        "<g style=\"fill:none; stroke:green; stroke-width:0.05; stroke-dasharray:0.5,0.5\" "
+        "marker-end=\"url(#control)\">\n");
+
+    for (int i=0; i<(int)parts.size(); i++)
+        write_control_data(parts[i]);
+
+    print("</g>\n");
 }
 
 
 void svg::write_tree(const path& p)
 {
-    if (f==NULL || p.empty())
+    if (sink==NULL || p.empty())
         return;
     
-    fprintf(f, "<path style=\"fill:none; stroke:blue; stroke-width:0.1\" ");
+    print("<path style=\"fill:none; stroke:blue; stroke-width:0.1\" ");
 
-    fprintf(f, "marker-mid=\"url(#blue)\" marker-start=\"url(#blue)\" marker-end=\"url(#blue)\" d=\"");
+    print("marker-mid=\"url(#blue)\" marker-start=\"url(#blue)\" marker-end=\"url(#blue)\" d=\"");
 
     for (int i=p.size()-1; i>0; i--)
     {
@@ -175,17 +443,27 @@ void svg::write_tree(const path& p)
         
         assert(j>=0);
 
-        fprintf(f, "M%.1f %.1f L%.1f %.1f ", p[j].x, p[j].y, p[i].x, p[i].y);
+        print("M%.1f %.1f L%.1f %.1f ", p[j].x, p[j].y, p[i].x, p[i].y);
     }
 
-    fprintf(f, "\" />\n");
+    print("\" />\n");
+}
+
+
+// unformatted output, e.g. a part of an SVG file written before
+void svg::write_raw(const char* data, size_t len)
+{
+    if (sink==NULL)
+        return;
+
+    put(data, len);
 }
 
 
 void svg::write_end()
 {
-    if (f==NULL)
+    if (sink==NULL)
         return;
     
-    fprintf(f, "</g>\n</svg>\n");
+    print("</g>\n</svg>\n");
 }
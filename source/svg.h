@@ -2,8 +2,13 @@
 #define _SVG_H_
 
 #include <stdio.h>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "path.h"
+#include "spatial_index.h"
 
 
 // flags used in write_path()
@@ -13,24 +18,72 @@
 #define SVG_MARKER      8
 #define SVG_TEXT       16
 
+#define SVG_BUFFER  65536   // size of the output buffer
+#define SVG_BUFFERS 16      // buffers of the asynchronous output
+
+
+// receives the output (like fwrite()), returns the number of bytes written
+typedef size_t (*svg_sink)(void* ctx, const char* data, size_t len);
+
 
 class svg
 {
 private:
-    FILE* f;
+    svg_sink sink;          // NULL = closed
+    void* ctx;
+    FILE* f;                // file opened by open(filename)
+    char* buf;              // output buffer
+    int   pos;
+    long long flushed;      // bytes passed to the sink
+    bool  error;
+    spatial_index* index;   // elements are recorded here (svg_index), NULL = off
+
+    // asynchronous output (set_async()): full buffers are passed to the sink by a thread
+    thread* io;
+    mutex   io_lock;
+    condition_variable io_changed;
+    deque< pair<char*,int> > pending;
+    vector<char*> spare;
+    int   buffers;          // allocated, at most SVG_BUFFERS
+    bool  io_done;
+
+    svg(const svg&);
+    svg& operator=(const svg&);
+
+    void print(const char* format, ...);
+    void put(const char* data, size_t len);
+    void flush();
+    void io_run();
+    void write_style(const char* color, double stroke_width, int flags);
+    void write_data(const path_view& p, int flags);
+    void write_control_data(const path_view& p);
 
 public:
-    svg() : f(NULL) {}
+    svg() : sink(NULL), ctx(NULL), f(NULL), buf(NULL), pos(0), flushed(0), error(false), index(NULL),
+            io(NULL), buffers(0), io_done(false) {}
+    ~svg() { close(); }
 
     bool open(const char* filename);
+    bool open(svg_sink sink, void* ctx);
     bool close();
+    bool is_open() const { return sink!=NULL; }
+    void set_async();
+
+    // position in the output (bytes written so far)
+    long long tell() const { return flushed + pos; }
+    void set_index(spatial_index* index) { this->index = index; }
+    void add_item(int id, const bounds& b, long long start);
 
     void write_header(int w, int h);
     void write_image(int w, int h, const char* filename);
     void write_bezier(point* b, const char* color);
-    void write_path(const path& p, const char* color, double stroke_width, int flags);
+    void write_path(const path_view& p, const char* color, double stroke_width, int flags);
+    void write_paths(const vector<path_view>& parts, const char* color, double stroke_width, int flags);
+    void write_compound(const vector<const path*>& parts, const char* color, int flags);
     void write_control_points(const path& p);
+    void write_control_points(const vector<path_view>& parts);
     void write_tree(const path& p);
+    void write_raw(const char* data, size_t len);
     void write_end();
 };
 
@@ -0,0 +1,595 @@
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <deque>
+#include <filesystem>
+
+#include "sweep.h"
+#include "pipeline.h"
+#include "bitmap.h"
+#include "tracer.h"
+#include "svg.h"
+#include "output.h"
+#include "cache.h"
+#include "spatial_index.h"
+#include "sp_lines.h"
+#include "sp_bezier.h"
+#include "adaptive.h"
+#include "timer.h"
+#include "timeline.h"
+
+
+#define SWEEP_MAX_EDGES (1<<23)     // edges recorded per contour, beyond that phase 1 runs per set
+
+
+// an edge (i,j) of phase 1, measured with the largest l_max_distance of the grid
+class line_edge
+{
+public:
+    bool   feasible;        // at the largest distance
+    double dist;            // maximal distance * length of the intermediate points
+    double before;          // minimal projection onto the edge * length
+    double after;           // maximal projection onto the edge * length
+    double sum;             // sum of the distances * length
+};
+
+
+// the edges of phase 1 of a contour in the order of shortest_path::calculate()
+class line_table
+{
+public:
+    vector<int> first;      // index of the edge (j-1,j) of node j, first[n] = end
+    vector<line_edge> edges;
+
+    bool record(const parameter& par, const path& p);
+};
+
+
+// same tests and sums as sp_lines::cost() with all values kept
+static void measure(const path& p, int i, int j, double max_distance, line_edge& e)
+{
+    const point& p1 = p[i];
+    const point& p2 = p[j];
+    point p21 = p2 - p1;
+    point n = perp(p21);
+    double len = n.len();
+    double limit = len * max_distance;
+    double limit2 = len*len + limit;
+
+    e.feasible = false;
+    e.dist = 0;
+    e.before = 0;
+    e.after = 0;
+    e.sum = 0;
+
+    for (int k=i+1; k<j; k++)
+    {
+        point pk1 = p[k] - p1;
+
+        double d = dot(n, pk1);
+        if (d<0)
+            d = -d;
+        if (d > limit)
+            return;
+
+        e.sum += d;
+        if (k==i+1 || d > e.dist)
+            e.dist = d;
+
+        d = dot(p21, pk1);
+        if ((d < -limit) || d > limit2)
+            return;
+
+        if (k==i+1 || d < e.before)
+            e.before = d;
+        if (k==i+1 || d > e.after)
+            e.after = d;
+    }
+
+    e.feasible = true;
+}
+
+
+/**
+ * Evaluates the edges that shortest_path::calculate() scans with the
+ * limits and the distance of par. Parameter sets with smaller values scan
+ * a subset: their missing edges are missing with par as well.
+ *
+ * @return false if the contour has too many edges
+ */
+bool line_table::record(const parameter& par, const path& p)
+{
+    int n = p.size();
+
+    first.assign(n+1, 0);
+    edges.clear();
+
+    for (int j=1; j<n; j++)
+    {
+        int missed = 0;
+        first[j] = edges.size();
+
+        for (int i=j-1; i>=0 && i>=j-par.sp_depth_limit; i--)
+        {
+            line_edge e;
+            measure(p, i, j, par.l_max_distance, e);
+            edges.push_back(e);
+
+            if (!e.feasible)
+            {
+                if (++missed >= par.sp_missed_limit)
+                    break;
+            }
+            else
+                missed = 0;
+        }
+
+        if ((int)edges.size() > SWEEP_MAX_EDGES)
+            return false;
+    }
+    first[n] = edges.size();
+
+    return true;
+}
+
+
+// phase 1 with the edges of a line_table
+class sp_lines_replay : public sp_lines
+{
+private:
+    const line_table& table;
+
+public:
+    sp_lines_replay(const parameter& par, path& p, const line_table& table) : sp_lines(par, p), table(table) {}
+
+    virtual bool cost(int i, int j, double& cost)
+    {
+        int k = table.first[j] + j-1-i;
+        if (k >= table.first[j+1])
+            return sp_lines::cost(i, j, cost);
+
+        const line_edge& e = table.edges[k];
+        if (!e.feasible)
+            return false;
+
+        point n = perp(p[j] - p[i]);
+        double len = n.len();
+        double limit = len * par.l_max_distance;
+        double limit2 = len*len + limit;
+
+        if (e.dist > limit || e.before < -limit || e.after > limit2)
+            return false;
+
+        int cnt = j-i;
+        double dist = e.sum / (cnt * len);
+        cost = par.l_cost_segment + par.l_cost_distance * dist + par.l_cost_area * (e.sum/cnt);
+
+        return true;
+    }
+};
+
+
+// key of the parameters that determine the result of phase 1 and the intermediate points
+static string phase1_key(const parameter& par)
+{
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%d %.17g %d %d %d %.17g %.17g %.17g %.17g %.17g",
+        par.tr_middle_points, par.tr_min_area, par.sp_depth_limit, par.sp_missed_limit, par.sp_adaptive,
+        par.l_max_distance, par.l_cost_segment, par.l_cost_distance, par.l_cost_area,
+        par.b_corner_angle);
+    return buf;
+}
+
+
+// key of the parameters that determine the result of phase 2
+static string phase2_key(const parameter& par)
+{
+    char buf[512];
+    snprintf(buf, sizeof(buf), " %d %.17g %.17g %.17g %.17g",
+        par.b_fit_heuristic, par.b_max_distance, par.b_cost_curve, par.b_cost_area, par.b_cost_segment);
+    return phase1_key(par) + buf;
+}
+
+
+/**
+ * Adds an axis of the grid.
+ *
+ * @param str  "name=value,value,..."
+ * @return false if a value can't be parsed
+ */
+bool sweep::add_axis(const char* str)
+{
+    const char* eq = strchr(str, '=');
+    if (eq == NULL)
+        return false;
+
+    string name(str, eq-str);
+    vector<string> v;
+    parameter test;
+
+    for (const char* s = eq+1; ; )
+    {
+        const char* end = strchr(s, ',');
+        string value = end ? string(s, end-s) : string(s);
+        if (!test.parse((name + "=" + value).c_str()))
+            return false;
+        v.push_back(value);
+        if (end == NULL)
+            break;
+        s = end+1;
+    }
+
+    names.push_back(name);
+    values.push_back(v);
+
+    return true;
+}
+
+
+// all combinations of the axes, the last axis varies fastest
+void sweep::make_sets()
+{
+    sets.clear();
+    labels.clear();
+
+    vector<int> index(names.size(), 0);
+
+    for (;;)
+    {
+        parameter p = par;
+        string label;
+
+        for (int a=0; a<(int)names.size(); a++)
+        {
+            string s = names[a] + "=" + values[a][index[a]];
+            p.parse(s.c_str());
+            label += (a ? " " : "") + s;
+        }
+
+        sets.push_back(p);
+        labels.push_back(label);
+
+        int a = names.size()-1;
+        while (a>=0 && ++index[a]==(int)values[a].size())
+            index[a--] = 0;
+        if (a < 0)
+            break;
+    }
+}
+
+
+// name of the SVG file of a set: the extension is replaced by _SET.svg
+string sweep::svg_name(const char* filename, int set) const
+{
+    string name = filename;
+
+    if (outdir != NULL)
+        name = string(outdir) + "/" + filesystem::path(filename).filename().string();
+
+    size_t dot = name.find_last_of("./\\");
+    if (dot != string::npos && name[dot]=='.')
+        name.erase(dot);
+
+    return name + "_" + to_string(set) + ".svg";
+}
+
+
+/**
+ * Vectorizes an image with all parameter sets.
+ *
+ * @param filename_png  the image
+ * @return 0=OK, else error code of the PNG decoder or -5 (can't write SVG)
+ */
+int sweep::run(const char* filename_png)
+{
+    double c0 = time_ms();
+
+    make_sets();
+    int n = sets.size();
+
+    bitmap map;
+    int ret = map.init_from_png(filename_png);
+    if (ret!=0)
+        return ret;
+
+    double c1 = time_ms();
+    timeline::record("decode", c0, c1, "pixels", (long)map.get_width()*map.get_height());
+
+    // groups of sets with the same result of phase 1 and phase 2
+    vector<int> group1(n), group2(n);
+    vector<int> first1, first2;     // first set of every group
+    std::map<string, int> keys1, keys2;     // map is the bitmap here
+    for (int k=0; k<n; k++)
+    {
+        auto r1 = keys1.insert(make_pair(phase1_key(sets[k]), (int)first1.size()));
+        if (r1.second)
+            first1.push_back(k);
+        group1[k] = r1.first->second;
+
+        auto r2 = keys2.insert(make_pair(phase2_key(sets[k]), (int)first2.size()));
+        if (r2.second)
+            first2.push_back(k);
+        group2[k] = r2.first->second;
+    }
+    int n1 = first1.size();
+    int n2 = first2.size();
+
+    // the sets share phase 1 contour by contour, batches would not
+    for (int k=0; k<n; k++)
+        if (sets[k].sp_batch > 0)
+        {
+            fprintf(stderr, "sweep: sp_batch is not used, the sets share the stages per contour\n");
+            break;
+        }
+
+    // phase 1 of equal contours per group (cache_size)
+    vector<contour_cache> cache;
+    for (int g=0; g<n1; g++)
+        cache.push_back(contour_cache(sets[first1[g]].cache_size));
+
+    vector<svg> out(n);
+    vector<spatial_index> index(n);
+    deque<output_queue> queue;
+    vector<statistics> st(n);
+    for (int k=0; k<n; k++)
+    {
+        string name = svg_name(filename_png, k);
+        if (!out[k].open(name.c_str()))
+        {
+            fprintf(stderr, "can't write %s\n", name.c_str());
+            return -5;
+        }
+        out[k].write_header(map.get_width(), map.get_height());
+        out[k].write_image(map.get_width(), map.get_height(), filename_png);
+        if (sets[k].svg_index)
+            out[k].set_index(&index[k]);
+    }
+
+    double trace_ms = 0, record_ms = 0;
+    int contours = 0, recorded = 0;
+
+    // one pass per value of tr_middle_points
+    vector<bool> done(n1, false);
+    for (int g0=0; g0<n1; g0++)
+    {
+        if (done[g0])
+            continue;
+
+        // the contours are the same in every pass
+        bool first_pass = g0 == 0;
+
+        int middle = sets[first1[g0]].tr_middle_points;
+        vector<bool> active(n1, false);
+        for (int g=0; g<n1; g++)
+            if (!done[g] && sets[first1[g]].tr_middle_points==middle)
+                active[g] = done[g] = true;
+
+        // record with the largest distance and limits of the active groups
+        parameter rec = sets[first1[g0]];
+        for (int g=0; g<n1; g++)
+            if (active[g])
+            {
+                const parameter& q = sets[first1[g]];
+                rec.l_max_distance = max(rec.l_max_distance, q.l_max_distance);
+                rec.sp_depth_limit = max(rec.sp_depth_limit, q.sp_depth_limit);
+                rec.sp_missed_limit = max(rec.sp_missed_limit, q.sp_missed_limit);
+            }
+
+        // output of the sets of this pass, svg_queue starts a thread per set
+        vector<output_queue*> oq(n, NULL);
+        for (int k=0; k<n; k++)
+            if (active[group1[k]])
+            {
+                queue.emplace_back(&out[k], sets[k]);
+                oq[k] = &queue.back();
+            }
+
+        double c2 = time_ms();
+        tracer t(map);
+        if (par.tr_bands > 0)
+            t.trace_bands(par.tr_bands);
+        trace_ms += time_ms() - c2;
+        timeline::record("tracer", c2, time_ms(), "bands", par.tr_bands);
+
+        vector< vector<path> > outline(n);
+        int x, y;
+
+        for (;;)
+        {
+            c2 = time_ms();
+            path p;
+            bool found = t.get_next_contour(x, y);
+            int id = found ? t.trace_points(x, y, middle!=0, p) : 0;
+            double c3 = time_ms();
+            trace_ms += c3 - c2;
+            if (!found)
+                break;
+            timeline::record("trace", c2, c3, "points", p.size());
+
+            if (first_pass)
+                contours++;
+
+            // groups whose tr_min_area keeps the contour (specks are dropped)
+            vector<bool> live(n1, false);
+            bool any = false;
+            for (int g=0; g<n1; g++)
+                if (active[g] && t.get_contour(id).area >= sets[first1[g]].tr_min_area)
+                    live[g] = any = true;
+            if (!any)
+                continue;
+
+            // phase 1 from the caches, the table is only recorded if a group needs it
+            vector<const fitted*> hit(n1, NULL);
+            bool needed = false;
+            for (int g=0; g<n1; g++)
+                if (live[g])
+                {
+                    hit[g] = cache[g].find(p);
+                    if (hit[g] == NULL)
+                        needed = true;
+                }
+
+            line_table table;
+            bool ok = false;
+            if (needed)
+            {
+                c2 = time_ms();
+                ok = table.record(rec, p);
+                if (ok)
+                    recorded++;
+                else
+                    table.edges.clear();
+                c3 = time_ms();
+                record_ms += c3 - c2;
+                timeline::record("record", c2, c3, "edges", table.edges.size());
+            }
+
+            // phase 1 and intermediate points per group
+            vector<vector<int> > i1(n1);
+            vector<path> l(n1), l2(n1);
+            vector<double> cost1(n1), time1(n1), time_middle(n1);
+            for (int g=0; g<n1; g++)
+            {
+                if (!live[g])
+                    continue;
+
+                const parameter& q = sets[first1[g]];
+                c3 = time_ms();
+
+                if (hit[g] != NULL)
+                {
+                    i1[g] = hit[g]->nodes;
+                    cost1[g] = hit[g]->cost1;
+                }
+                else
+                {
+                    search_limits lim;
+                    sp_lines_replay rpl(q, p, table);
+                    sp_lines spl(q, p);
+                    sp_lines& sp = ok ? rpl : spl;
+                    if (q.sp_adaptive)
+                    {
+                        lim.calculate(q, p);
+                        sp.set_limits(&lim);
+                    }
+                    sp.calculate();
+                    cost1[g] = sp.extract(i1[g]);
+
+                    if (cache[g].enabled())
+                    {
+                        fitted f;
+                        f.p = p;
+                        f.nodes = i1[g];
+                        f.cost1 = cost1[g];
+                        cache[g].insert(f);
+                    }
+                }
+                path_view(p, i1[g]).copy(l[g]);
+
+                double c4 = time_ms();
+                intermediate_points(l[g], l2[g], q.b_corner_angle);
+                double c5 = time_ms();
+
+                time1[g] = c4 - c3;
+                time_middle[g] = c5 - c4;
+                timeline::record("phase1", c3, c4, "group", g);
+                timeline::record("middle", c4, c5, "group", g);
+            }
+
+            // phase 2 per group, it sets flags in its copy of the intermediate points
+            vector<path> b(n2);
+            vector<double> cost2(n2), time2(n2);
+            for (int h=0; h<n2; h++)
+            {
+                const parameter& q = sets[first2[h]];
+                int g = group1[first2[h]];
+                if (!live[g])
+                    continue;
+
+                c3 = time_ms();
+                path lm = l2[g];
+                sp_bezier spb(q, lm);
+                spb.calculate();
+                cost2[h] = spb.extract(b[h]);
+                double c4 = time_ms();
+                time2[h] = c4 - c3;
+                timeline::record("phase2", c3, c4, "group", h);
+            }
+
+            // output and statistics per set, as vectorize()
+            for (int k=0; k<n; k++)
+            {
+                int g = group1[k];
+                int h = group2[k];
+                if (!live[g])
+                    continue;
+
+                const parameter& q = sets[k];
+
+                st[k].points += p.size() - 1;
+                st[k].time1 += time1[g];
+                st[k].time_middle += time_middle[g];
+                st[k].time2 += time2[h];
+                count_contour(q, 3, l[g].size()-1, cost1[g], b[h], cost2[h], st[k]);
+
+                // copies of the paths the set writes, the output takes them over
+                path pk, lk, l2k, bk;
+                if (q.svg_points)
+                    pk = p;
+                if (q.svg_lines1)
+                    lk = l[g];
+                if (q.svg_lines2)
+                    l2k = l2[g];
+                if (q.svg_curves || q.svg_fill)
+                    bk = b[h];
+                output_contour(&out[k], q, *oq[k], id, pk, lk, l2k, bk, q.svg_fill ? &outline[k] : NULL);
+            }
+        }
+
+        for (int k=0; k<n; k++)
+            if (oq[k] != NULL)
+            {
+                oq[k]->finish();
+                if (sets[k].svg_fill)
+                    write_filled(out[k], t, outline[k], sets[k].svg_fill);
+            }
+    }
+
+    int failed = 0;
+    for (int k=0; k<n; k++)
+    {
+        string name = svg_name(filename_png, k);
+        out[k].write_end();
+        int status = out[k].close() ? 0 : -5;
+        if (status==0 && sets[k].svg_index && !index[k].save((name + ".idx").c_str()))
+            status = -5;
+        if (status!=0)
+        {
+            fprintf(stderr, "can't write %s\n", name.c_str());
+            failed++;
+        }
+
+        printf("{\"set\":%d,\"params\":", k);
+        write_json_string(stdout, labels[k].c_str());
+        printf(",\"svg\":");
+        write_json_string(stdout, name.c_str());
+        printf(",\"status\":%d"
+            ",\"points\":%d,\"lines\":%d,\"area1\":%.0f,\"ms1\":%.3f"
+            ",\"curves\":%d,\"segments\":%d,\"area2\":%.0f,\"ms2\":%.3f",
+            status, st[k].points, st[k].lines, st[k].area1, st[k].time1,
+            st[k].curves, st[k].segments, st[k].area2, st[k].time2);
+        if (sets[k].cache_size > 0)
+            printf(",\"cache_hits\":%d,\"cache_lookups\":%d",
+                cache[group1[k]].hits, cache[group1[k]].lookups);
+        printf("}\n");
+    }
+
+    printf("{\"file\":");
+    write_json_string(stdout, filename_png);
+    printf(",\"sets\":%d,\"phase1_groups\":%d,\"phase2_groups\":%d"
+        ",\"contours\":%d,\"recorded\":%d,\"decode_ms\":%.3f,\"trace_ms\":%.3f,\"record_ms\":%.3f,\"ms\":%.3f}\n",
+        n, n1, n2, contours, recorded, c1-c0, trace_ms, record_ms, time_ms()-c0);
+    fflush(stdout);
+
+    return failed ? -5 : 0;
+}
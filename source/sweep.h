@@ -0,0 +1,42 @@
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+#include <string>
+
+#include "parameter.h"
+#include "path.h"
+
+
+/**
+ * Vectorizes one image with a grid of parameter sets. The image is decoded
+ * and traced once. For every contour the edges of phase 1 are evaluated
+ * once with the largest l_max_distance and limits of the grid. All
+ * parameter sets replay them: an edge feasible at distance d is feasible
+ * at every larger distance, and its area does not depend on the distance.
+ * Sets with the same phase 1 (or phase 2) parameters share its result.
+ *
+ * Every set gets its own SVG file and one JSON line on stdout.
+ */
+class sweep
+{
+private:
+    const parameter& par;       // parameters common to all sets
+    const char* outdir;         // directory for the SVG files, NULL = next to the PNG file
+
+    vector<string> names;       // one axis of the grid per parameter
+    vector< vector<string> > values;
+
+    vector<parameter> sets;     // all combinations
+    vector<string> labels;      // "name=value ..." of every set
+
+    void make_sets();
+    string svg_name(const char* filename, int set) const;
+
+public:
+    sweep(const parameter& par, const char* outdir) : par(par), outdir(outdir) {}
+
+    bool add_axis(const char* str);
+    int  run(const char* filename_png);
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include <stdio.h>
+
+#include "timeline.h"
+#include "timer.h"
+
+
+mutex timeline::lock;
+vector<timeline::ring*> timeline::rings;
+size_t timeline::capacity = 0;
+double timeline::origin = 0;
+thread_local timeline::ring* timeline::local = NULL;
+thread_local timeline::hook_function timeline::hook = NULL;
+thread_local void* timeline::hook_ctx = NULL;
+bool timeline::enabled = false;
+
+
+/**
+ * Starts recording.
+ *
+ * @param events_per_thread  size of the ring buffer of every thread
+ */
+void timeline::enable(size_t events_per_thread)
+{
+    lock_guard<mutex> guard(lock);
+
+    capacity = events_per_thread>0 ? events_per_thread : 1;
+    origin = time_ms();
+    enabled = true;
+}
+
+
+/**
+ * Sets the hook of the calling thread, record() calls it at the end of
+ * every event of this thread whether the timeline records or not.
+ *
+ * @param h    hook or NULL (none)
+ * @param ctx  its first argument
+ */
+void timeline::set_hook(hook_function h, void* ctx)
+{
+    hook = h;
+    hook_ctx = ctx;
+}
+
+
+void timeline::add(const char* name, double begin, double end, const char* arg_name, long arg)
+{
+    if (hook != NULL)
+        hook(hook_ctx, name, begin, end);
+
+    // only the hook, not recording
+    if (capacity == 0)
+        return;
+
+    if (local == NULL)
+    {
+        // first event of this thread
+        ring* r = new ring;
+        r->count = 0;
+
+        lock_guard<mutex> guard(lock);
+        r->tid = rings.size() + 1;
+        rings.push_back(r);
+        local = r;
+    }
+
+    // the ring grows up to its capacity, then the oldest event is overwritten
+    if (local->events.size() < capacity)
+        local->events.push_back(event());
+
+    event& e = local->events[local->count++ % capacity];
+    e.name = name;
+    e.arg_name = arg_name;
+    e.arg = arg;
+    e.begin = begin;
+    e.end = end;
+}
+
+
+/**
+ * Writes the recorded events as Chrome trace events (complete events,
+ * timestamps in microseconds). Must not run concurrently with record().
+ *
+ * @param filename  the JSON file to be written
+ *
+ * @return true=OK, false=can't write file
+ */
+bool timeline::write(const char* filename)
+{
+    FILE* f = fopen(filename, "w");
+    if (f==NULL)
+        return false;
+
+    lock_guard<mutex> guard(lock);
+
+    fprintf(f, "{\"traceEvents\":[\n");
+
+    bool first = true;
+    long lost = 0;
+
+    for (int i=0; i<(int)rings.size(); i++)
+    {
+        const ring& r = *rings[i];
+        size_t n = r.count < capacity ? r.count : capacity;
+        lost += r.count - n;
+
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+            first ? "" : ",\n", r.tid, r.tid);
+        first = false;
+
+        // oldest event first
+        for (size_t k=r.count-n; k<r.count; k++)
+        {
+            const event& e = r.events[k % capacity];
+
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                e.name, r.tid, (e.begin-origin)*1000, (e.end-e.begin)*1000);
+            if (e.arg_name != NULL)
+                fprintf(f, ",\"args\":{\"%s\":%ld}", e.arg_name, e.arg);
+            fprintf(f, "}");
+        }
+    }
+
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"lost_events\":%ld}}\n", lost);
+
+    return fclose(f)==0;
+}
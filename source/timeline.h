@@ -0,0 +1,72 @@
+#ifndef _TIMELINE_H_
+#define _TIMELINE_H_
+
+#include <stddef.h>
+#include <mutex>
+
+#include "path.h"
+
+
+/**
+ * Timeline of the pipeline, written as Chrome trace events (JSON) for
+ * chrome://tracing or Perfetto. Every thread records its events into its
+ * own ring buffer, which grows with the events recorded up to the
+ * capacity; then the oldest events are overwritten.
+ * While the timeline is disabled, record() costs one test of a flag and
+ * one of the hook of the thread. A hook of a thread sees its events as
+ * they end, also without recording (spvec_bench --perf reads the
+ * hardware counters there). It is thread local, so setting it needs no
+ * lock and does not affect other threads.
+ *
+ * Event and argument names must be string literals.
+ */
+class timeline
+{
+public:
+    // called at the end of every event of the thread that set it
+    typedef void (*hook_function)(void* ctx, const char* name, double begin, double end);
+
+private:
+    class event
+    {
+    public:
+        const char* name;
+        const char* arg_name;   // NULL = no argument
+        long   arg;
+        double begin, end;      // ms, see time_ms()
+    };
+
+    class ring
+    {
+    public:
+        int    tid;
+        vector<event> events;
+        size_t count;           // events recorded
+    };
+
+    static mutex lock;          // guards rings
+    static vector<ring*> rings;
+    static size_t capacity;     // events per thread
+    static double origin;       // time of enable() (ms)
+    static thread_local ring* local;
+    static thread_local hook_function hook;
+    static thread_local void* hook_ctx;
+
+    static void add(const char* name, double begin, double end, const char* arg_name, long arg);
+
+public:
+    static bool enabled;        // recording, set by enable() before the threads start
+
+    static void enable(size_t events_per_thread);
+    static bool write(const char* filename);
+    static void set_hook(hook_function h, void* ctx);
+
+    // record an event of the calling thread from begin to end (ms, see time_ms())
+    static void record(const char* name, double begin, double end, const char* arg_name=NULL, long arg=0)
+    {
+        if (enabled || hook != NULL)
+            add(name, begin, end, arg_name, arg);
+    }
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+
+// monotonic wall clock time in milliseconds (valid across threads, unlike clock())
+inline double time_ms()
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// p-th percentile (0..100) of sorted samples, nearest rank
+inline double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+
+    int i = (int)(p/100*sorted.size() + 0.5) - 1;
+    i = std::max(0, std::min(i, (int)sorted.size()-1));
+
+    return sorted[i];
+}
+
+#endif
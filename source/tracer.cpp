@@ -1,19 +1,133 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
 #include "tracer.h"
 
 
+// The contour is traced clockwise. The direction to follow is determined
+// by sampling 2x2 bits at the current position. The sampled bits are
+// interpreted as a 4 bit integer value:
+//
+// index = 8*B[x-1,y-1] + 4*B[x,y-1] + 2*B[x-1,y] + B[x,y]
+//
+// +---------+-------+
+// |(x-1,y-1)|(x,y-1)|           x' = x + dx[index]
+// +---------O-------+           y' = y + dy[index]
+// | (x-1,y) | (x,y) |
+// +---------+-------+
+//
+//                 index:   0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15
+//
+//       2x2 pixel block:  00 00 00 00 01 01 01 01 10 10 10 10 11 11 11 11
+//                         00 01 10 11 00 01 10 11 00 01 10 11 00 01 10 11
+//
+//   direction to follow:   -  r  d  r  u  u  ?  u  l  ?  d  r  l  l  d  -
+//
+const char tracer::dx[16] =      { 0, 1, 0, 1, 0, 0, 0, 0,-1, 0, 0, 1,-1,-1, 0, 0};
+const char tracer::dy[16] =      { 0, 0, 1, 0,-1,-1, 0,-1, 0, 0, 1, 0, 0, 0, 1, 0};
+const char tracer::second[16] =  { 0, 4, 1, 4, 8, 8, 0, 8, 2, 0, 1, 4, 2, 2, 1, 0};
+
+// The rows are scanned from a clear pixel left of the image. A contour
+// whose vertical edges all lie on the left and right border (a set
+// background, or a set band across the whole width) is the image frame:
+// its set pixels are background, it is not returned as a contour, and the
+// contours inside it have no parent.
+#define FRAME -2            // contour id of the edges of the image frame
+
+
 void tracer::init()
 {
-    posx = 0;
     posy = 0;
-    color = map.bit_is_set(0, 0);
 
-    // initialize (and clear) bitmap to mark contours already traced
-    bb.init(map.get_width(), map.get_height());
+    // traced contour edges are recorded per row
+    edges.init(0, map.get_height(), map.get_width());
+
+    contours.clear();
+    frame.assign(map.get_height(), 0);
+
+    bands.clear();
+    segments.clear();
+    tiles.clear();
+    next_tile = 0;
+
+    start_row();
+}
+
+
+// prepare scanning row posy
+void tracer::start_row()
+{
+    posx = 0;
+    color = false;          // left of the image is background
+    left = -1;
+
+    if (posy < map.get_height())
+        edges.start_row(posy);
+}
+
+
+/**
+ * Checks whether the contour starting at (x,y) on the left border is the
+ * image frame. If it is, its edges are recorded as FRAME and its rows in
+ * frame.
+ */
+bool tracer::trace_frame(int x, int y)
+{
+    int w = map.get_width();
+    int sx = x;
+    int sy = y;
+    int last = 8;           // see trace_points()
+
+    // an edge inside the image makes it a contour
+    do
+    {
+        int index = direction(map, x, y, last);
+        if (dy[index]!=0 && x>0 && x<w)
+            return false;
+
+        x += dx[index];
+        y += dy[index];
+        last = index;
+    }
+    while (x!=sx || y!=sy);
+
+    do
+    {
+        int index = direction(map, x, y, last);
+
+        if (dy[index] > 0)
+            edges.mark(x, y, FRAME);
+        else if (dy[index] < 0)
+            edges.mark(x, y-1, FRAME);
+
+        if (dy[index]!=0 && x==0)
+            frame[dy[index] > 0 ? y : y-1] = 1;
+
+        x += dx[index];
+        y += dy[index];
+        last = index;
+    }
+    while (x!=sx || y!=sy);
+
+    return true;
 }
 
 
 bool tracer::get_next_contour(int& x, int& y)
 {
+    if (!bands.empty())
+    {
+        // tiled mode
+        if (next_tile >= (int)tiles.size())
+            return false;
+
+        x = tiles[next_tile].x;
+        y = tiles[next_tile].y;
+        return true;
+    }
+
     while (posy < map.get_height())
     {
         if (color)
@@ -25,21 +139,26 @@ bool tracer::get_next_contour(int& x, int& y)
         {
             color = !color;
 
-            if (bb.bit_is_set(posx, posy)==false)
+            int id = edges.owner(posx);
+            if (id == -1 && posx == 0 && trace_frame(posx, posy))
+                id = edges.owner(posx);
+
+            if (id == -1)
             {
                 // contour has not yet been traced
                 x = posx;
                 y = posy;
                 return true;
             }
+
+            left = id;
         }
         else
         {
             // next row
             if (++posy >= map.get_height())
                 break;
-            color = map.bit_is_set(0, posy);
-            posx = 0;
+            start_row();
         }
     }
 
@@ -47,56 +166,77 @@ bool tracer::get_next_contour(int& x, int& y)
 }
 
 
-void tracer::trace_points(int x, int y, bool middle_points, path& p)
+/**
+ * Traces the contour starting at (x,y) and returns its index.
+ *
+ * If (x,y) was returned by get_next_contour(), the enclosing contour is
+ * determined from the contour of the last edge passed in this row: the
+ * run between both edges lies inside that contour if it is of the other
+ * kind (outer/hole), otherwise both contours have the same parent.
+ * The enclosed area is summed along the steps (shoelace formula), it
+ * costs two multiplications per step.
+ */
+int tracer::trace_points(int x, int y, bool middle_points, path& p)
 {
-    // The contour is traced clockwise starting at (x,y). The direction to
-    // follow is determined by sampling 2x2 bits at the current position.
-    // The sampled bits are interpreted as a 4 bit integer value:
-    //
-    // index = 8*B[x-1,y-1] + 4*B[x,y-1] + 2*B[x-1,y] + B[x,y]
-    //
-    // +---------+-------+
-    // |(x-1,y-1)|(x,y-1)|           x' = x + dx[index]
-    // +---------O-------+           y' = y + dy[index]
-    // | (x-1,y) | (x,y) |
-    // +---------+-------+
-    //
-    //                 index:   0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15
-    //
-    //       2x2 pixel block:  00 00 00 00 01 01 01 01 10 10 10 10 11 11 11 11
-    //                         00 01 10 11 00 01 10 11 00 01 10 11 00 01 10 11
-    //
-    //   direction to follow:   -  r  d  r  u  u  ?  u  l  ?  d  r  l  l  d  -
-    //
-    static char dx[16] =      { 0, 1, 0, 1, 0, 0, 0, 0,-1, 0, 0, 1,-1,-1, 0, 0};
-    static char dy[16] =      { 0, 0, 1, 0,-1,-1, 0,-1, 0, 0, 1, 0, 0, 0, 1, 0};
-    static char second[16] =  { 0, 4, 1, 4, 8, 8, 0, 8, 2, 0, 1, 4, 2, 2, 1, 0};
-    
+    p.clear();
+
+    p.push_back(node(x, y));
+
+    if (!bands.empty())
+    {
+        // tiled mode: the contour has already been traced
+        const tiled& c = tiles[next_tile];
+        long long twice = 0;    // twice the signed area
+
+        assert(x==c.x && y==c.y);
+
+        for (int i=c.first; i<c.first+c.count; i++)
+        {
+            const char* steps = segments[i].steps;
+
+            for (int j=0; j<segments[i].count; j++)
+            {
+                int index = steps[j];
+
+                if (middle_points)
+                    p.push_back(node(x + 0.5 * dx[index], y + 0.5 * dy[index]));
+
+                twice += (long long)x*dy[index] - (long long)y*dx[index];
+                x += dx[index];
+                y += dy[index];
+
+                p.push_back(node(x, y));
+            }
+        }
+
+        assert(x==c.x && y==c.y);
+
+        contours[next_tile].area = llabs(twice) * 0.5;
+        return next_tile++;
+    }
+
     int sx = x;
     int sy = y;
-    int last = 2;       // previous direction (down)
+    int last = 8;       // previous direction (left): a hole starting at a
+                        // diagonal (index 6) continues downwards
+    int id = contours.size();
+    long long twice = 0;    // twice the signed area (shoelace formula)
 
     assert((x==0 && map.bit_is_set(x, y)) || (x>0 && map.bit_is_set(x-1, y)!=map.bit_is_set(x, y)));
 
-    p.clear();
-
-    p.push_back(node(x, y));
-    
     do
     {
-        // index = 8*B[x-1,y-1] + 4*B[x,y-1] + 2*B[x-1,y] + B[x,y]
-        int index = map.get_point4(x, y);
-        
-        if (x<bb.get_width() && y<bb.get_height())
-            bb.set_bit(x,y);
-        
-        // special pattern?
-        if (index==6 || index==9)
-            index = second[last];
+        int index = direction(map, x, y, last);
         
+        if (dy[index] > 0)
+            edges.mark(x, y, id);
+        else if (dy[index] < 0)
+            edges.mark(x, y-1, id);
+
         if (middle_points)
             p.push_back(node(x + 0.5 * dx[index], y + 0.5 * dy[index]));
         
+        twice += (long long)x*dy[index] - (long long)y*dx[index];
         x += dx[index];
         y += dy[index];
         last = index;
@@ -104,5 +244,283 @@ void tracer::trace_points(int x, int y, bool middle_points, path& p)
         p.push_back(node(x, y));
     }
     while (x!=sx || y!=sy);
+
+    // nesting
+    contour c;
+    c.hole = !map.bit_is_set(sx, sy);
+    c.parent = -1;
+    c.area = llabs(twice) * 0.5;
+
+    if (sx==posx && sy==posy)
+    {
+        // pass the start edge
+        int ret = edges.owner(sx);
+        assert(ret == id);
+
+        if (left >= 0)
+            c.parent = contours[left].hole!=c.hole ? left : contours[left].parent;
+        left = id;
+    }
+
+    c.depth = c.parent<0 ? 0 : contours[c.parent].depth+1;
+    contours.push_back(c);
+
+    return id;
 }
 
+
+/**
+ * Traces all contours in n horizontal bands in parallel, each band with
+ * its own record of traced edges. The pieces of contours crossing the
+ * borders between bands are stitched together afterwards. Then
+ * get_next_contour() and trace_points() return the same contours in the
+ * same order as the sequential scan.
+ */
+void tracer::trace_bands(int n)
+{
+    int h = map.get_height();
+
+    init();
+
+    if (n > h)
+        n = h;
+    if (n <= 0)
+        return;
+
+    for (int i=0; i<n; i++)
+        bands.push_back(band(map, (long long)h*i/n, (long long)h*(i+1)/n));
+
+    // at most one thread per core, each traces the next band not yet taken
+    int workers = min(n, max(1, (int)thread::hardware_concurrency()));
+    atomic<int> next(0);
+    auto work = [&]()
+    {
+        for (int i; (i = next++) < n; )
+            bands[i].trace();
+    };
+
+    vector<thread> threads;
+    for (int i=1; i<workers; i++)
+        threads.push_back(thread(work));
+    work();
+    for (int i=0; i<(int)threads.size(); i++)
+        threads[i].join();
+
+    // number the pieces of all bands
+    vector<int> base(n+1, 0);
+    for (int i=0; i<n; i++)
+        base[i+1] = base[i] + bands[i].pieces.size();
+
+    vector<int> owner(base[n], -1);     // tile of every piece, FRAME = the image frame
+
+    // records the rows of a piece of the image frame, see trace_frame()
+    auto frame_rows = [&](const band& bd, const piece& c)
+    {
+        int x = c.sx;
+        int y = c.sy;
+        for (int k=0; k<c.count; k++)
+        {
+            int index = bd.chain[c.first+k];
+            if (dy[index]!=0 && x==0)
+                frame[dy[index] > 0 ? y : y-1] = 1;
+            x += dx[index];
+            y += dy[index];
+        }
+    };
+
+    for (int b=0; b<n; b++)
+    {
+        const band& bd = bands[b];
+
+        for (int i=0; i<(int)bd.pieces.size(); i++)
+        {
+            if (owner[base[b]+i] != -1)
+                continue;
+
+            const piece& c = bd.pieces[i];
+            tiled t;
+
+            if (!c.open && !c.inner)
+            {
+                owner[base[b]+i] = FRAME;
+                frame_rows(bd, c);
+                continue;
+            }
+
+            if (!c.open)
+            {
+                // closed contour inside the band
+                segment s;
+                s.steps = &bd.chain[c.first];
+                s.count = c.count;
+
+                t.x = c.sx;
+                t.y = c.sy;
+                t.first = segments.size();
+                t.count = 1;
+                t.band = b;
+                t.piece = i;
+
+                segments.push_back(s);
+                owner[base[b]+i] = tiles.size();
+                tiles.push_back(t);
+                continue;
+            }
+
+            // follow the contour through the bands; the start point of
+            // the sequential scan is the first edge passed by any band
+            vector< pair<int,int> > cycle;
+            int cb = b;
+            int ci = i;
+            int start = -1;
+            bool inner = false;
+
+            do
+            {
+                const piece& cc = bands[cb].pieces[ci];
+
+                owner[base[cb]+ci] = tiles.size();
+                inner = inner || cc.inner;
+
+                if (cc.fy >= 0)
+                {
+                    if (start < 0)
+                        start = cycle.size();
+                    else
+                    {
+                        const piece& sc = bands[cycle[start].first].pieces[cycle[start].second];
+                        if (cc.fy < sc.fy || (cc.fy==sc.fy && cc.fx < sc.fx))
+                            start = cycle.size();
+                    }
+                }
+
+                cycle.push_back(make_pair(cb, ci));
+
+                // the piece entering at the end point
+                const band* nb;
+                int lo, hi;
+
+                if (cc.ey < bands[cb].y0)
+                {
+                    nb = &bands[--cb];
+                    lo = nb->above;
+                    hi = nb->open;
+                }
+                else
+                {
+                    nb = &bands[++cb];
+                    lo = 0;
+                    hi = nb->above;
+                }
+
+                // binary search for the entry point
+                while (lo < hi)
+                {
+                    int mid = (lo+hi)/2;
+                    if (nb->pieces[mid].sx < cc.ex)
+                        lo = mid+1;
+                    else
+                        hi = mid;
+                }
+
+                assert(lo < (int)nb->pieces.size() && nb->pieces[lo].sx==cc.ex && nb->pieces[lo].sy==cc.ey);
+                ci = lo;
+            }
+            while (cb!=b || ci!=i);
+
+            if (!inner)
+            {
+                for (int j=0; j<(int)cycle.size(); j++)
+                {
+                    const band& bj = bands[cycle[j].first];
+                    owner[base[cycle[j].first]+cycle[j].second] = FRAME;
+                    frame_rows(bj, bj.pieces[cycle[j].second]);
+                }
+                continue;
+            }
+
+            assert(start >= 0);
+
+            // split the start piece at the start point
+            int sb = cycle[start].first;
+            const piece& sc = bands[sb].pieces[cycle[start].second];
+            const char* steps = &bands[sb].chain[sc.first];
+            int x = sc.sx;
+            int y = sc.sy;
+            int k = 0;
+
+            while (x!=sc.fx || y!=sc.fy)
+            {
+                assert(k < sc.count);
+                x += dx[(int)steps[k]];
+                y += dy[(int)steps[k]];
+                k++;
+            }
+
+            t.x = sc.fx;
+            t.y = sc.fy;
+            t.first = segments.size();
+            t.band = sb;
+            t.piece = cycle[start].second;
+
+            segment s;
+            s.steps = steps + k;
+            s.count = sc.count - k;
+            segments.push_back(s);
+
+            for (int j=1; j<(int)cycle.size(); j++)
+            {
+                int cj = (start+j) % cycle.size();
+                const band& bj = bands[cycle[cj].first];
+                const piece& pj = bj.pieces[cycle[cj].second];
+
+                s.steps = &bj.chain[pj.first];
+                s.count = pj.count;
+                segments.push_back(s);
+            }
+
+            s.steps = steps;
+            s.count = k;
+            segments.push_back(s);
+
+            t.count = segments.size() - t.first;
+            tiles.push_back(t);
+        }
+    }
+
+    // sort the contours in the order of the sequential scan
+    vector< pair< pair<int,int>, int> > order(tiles.size());
+    for (int i=0; i<(int)tiles.size(); i++)
+        order[i] = make_pair(make_pair(tiles[i].y, tiles[i].x), i);
+    sort(order.begin(), order.end());
+
+    vector<int> index(tiles.size());
+    vector<tiled> sorted(tiles.size());
+    for (int i=0; i<(int)order.size(); i++)
+    {
+        index[order[i].second] = i;
+        sorted[i] = tiles[order[i].second];
+    }
+    tiles.swap(sorted);
+
+    // nesting, see trace_points()
+    contours.resize(tiles.size());
+
+    for (int i=0; i<(int)tiles.size(); i++)
+    {
+        const tiled& t = tiles[i];
+        const piece& sc = bands[t.band].pieces[t.piece];
+        contour& c = contours[i];
+
+        c.hole = sc.hole;
+        c.parent = -1;
+
+        if (sc.left >= 0 && owner[base[t.band]+sc.left] != FRAME)
+        {
+            int l = index[owner[base[t.band]+sc.left]];
+            c.parent = contours[l].hole!=c.hole ? l : contours[l].parent;
+        }
+
+        c.depth = c.parent<0 ? 0 : contours[c.parent].depth+1;
+    }
+}
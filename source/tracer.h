@@ -3,24 +3,95 @@
 
 #include "bitmap.h"
 #include "path.h"
+#include "edges.h"
+#include "band.h"
+
+
+// nesting information of a traced contour
+class contour
+{
+public:
+    int  parent;            // index of the enclosing contour, -1 = none
+    int  depth;             // nesting depth, 0 = not enclosed
+    bool hole;              // inner contour (boundary of a hole)
+    double area;            // enclosed area in pixels (holes included), see trace_points()
+};
 
 
 class tracer
 {
 private:
+    // steps of a contour traced by trace_bands()
+    class segment
+    {
+    public:
+        const char* steps;
+        int count;
+    };
+
+    // a contour traced by trace_bands()
+    class tiled
+    {
+    public:
+        int x, y;           // start point
+        int first;          // index of the first segment
+        int count;          // number of segments
+        int band;           // band and piece containing the start point
+        int piece;
+    };
+
+    static const char second[16];
+
     const bitmap& map;
     
     // state
-    bitmap bb;              // traced contours are marked in bb
+    edge_rows edges;        // traced contour edges
     int    posx, posy;
     bool   color;
+    int    left;            // contour of the last edge passed in this row, -1 = none
+
+    vector<contour> contours;
+    vector<char>    frame;  // rows whose first pixel lies inside the image frame
+
+    // tiled mode
+    vector<band>    bands;
+    vector<segment> segments;
+    vector<tiled>   tiles;  // contours in the order of the sequential scan
+    int    next_tile;
+
+    void start_row();
+    bool trace_frame(int x, int y);
 
 public:
+    static const char dx[16];
+    static const char dy[16];
+
     tracer(const bitmap& map) : map(map) { init(); }
 
     void init();
+    void trace_bands(int n);
     bool get_next_contour(int& x, int& y);
-    void trace_points(int x, int y, bool middle_points, path& p);
+    int  trace_points(int x, int y, bool middle_points, path& p);
+
+    int  get_contour_count() const { return contours.size(); }
+    const contour& get_contour(int i) const { return contours[i]; }
+
+    // the set pixels of row y inside the image frame are background,
+    // valid after all contours have been returned by get_next_contour()
+    bool in_frame(int y) const { return frame[y]!=0; }
+
+    // direction to follow at (x,y) (index into dx, dy), see trace_points()
+    static int direction(const bitmap& map, int x, int y, int last)
+    {
+        // index = 8*B[x-1,y-1] + 4*B[x,y-1] + 2*B[x-1,y] + B[x,y]
+        int index = map.get_point4(x, y);
+
+        // special pattern?
+        if (index==6 || index==9)
+            index = second[last];
+
+        return index;
+    }
 };
 
 #endif
@@ -0,0 +1,361 @@
+/*
+ * Tuner of the search limits and the Bézier parameters for a corpus
+ *
+ * spvec_tune [--sample N] [--candidates N] [--reps N] [--tolerance F]
+ *            [--seed N] [--out FILE] FILE.png ... [name=value,value,...] [name=value ...]
+ *
+ * Candidates are drawn from a grid of parameter values. Every argument
+ * name=value,value,... is an axis, without axes the default grid below is
+ * used. The current parameters (spvec.par and name=value arguments) are
+ * always candidate 0.
+ *
+ * Successive halving: in the first round every candidate vectorizes one
+ * image of the sample, in every following round the number of images is
+ * doubled and the better half of the candidates survives, until the whole
+ * sample is used. Candidates are compared by
+ *
+ *   time  median time of vectorize() over --reps runs, summed over the images
+ *   cost  area2 + b_cost_curve*curves + b_cost_segment*segments, with the
+ *         weights of the current parameters for all candidates
+ *
+ * and ranked by Pareto layers, ties by cost. The Pareto front of the last
+ * round is printed as JSON lines, followed by the current parameters. The
+ * chosen candidate is the fastest one on the front whose cost exceeds the
+ * lowest cost by at most --tolerance (default 0.01). It is written to --out
+ * (default spvec.par, the parameters of spvec).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <set>
+#include <random>
+#include <algorithm>
+
+#include "spvec.h"
+#include "bitmap.h"
+#include "timer.h"
+
+
+// default grid
+static const char* default_axes[] =
+{
+    "sp_depth_limit=25,50,100,200,500",
+    "sp_missed_limit=3,5,10,20",
+    "b_max_distance=0.8,1.1,1.5",
+    "b_cost_curve=10,20,40",
+    "b_cost_segment=20,40,80",
+    NULL
+};
+
+
+// an axis of the grid: name and values
+class axis
+{
+public:
+    string name;
+    vector<string> values;
+
+    bool parse(const char* str);
+};
+
+
+// a parameter set and its results on the images evaluated so far
+class candidate
+{
+public:
+    parameter par;
+    string label;           // "name=value ..." of the axes
+    vector<double> time;    // per image, median (ms)
+    vector<double> cost;    // per image
+    vector<int> size;       // curves + segments per image
+    vector<double> area;    // area2 per image
+    double total_time;      // sums over the images of the round
+    double total_cost;
+    int    layer;           // Pareto layer, 0 = front
+};
+
+
+// parse "name=value,value,..."
+bool axis::parse(const char* str)
+{
+    const char* eq = strchr(str, '=');
+    if (eq == NULL)
+        return false;
+
+    name = string(str, eq-str);
+    values.clear();
+
+    parameter test;
+    for (const char* s = eq+1; ; )
+    {
+        const char* end = strchr(s, ',');
+        string value = end ? string(s, end-s) : string(s);
+        if (!test.parse((name + "=" + value).c_str()))
+            return false;
+        values.push_back(value);
+        if (end == NULL)
+            break;
+        s = end+1;
+    }
+
+    return true;
+}
+
+
+// vectorize image i with the candidate reps times
+static void evaluate(candidate& c, const parameter& ref, const bitmap& map, int reps)
+{
+    vector<double> t;
+    statistics st;
+
+    for (int r=0; r<reps; r++)
+    {
+        st = statistics();
+        double c0 = time_ms();
+        vectorize(c.par, map, NULL, st, NULL, NULL);
+        t.push_back(time_ms() - c0);
+    }
+    sort(t.begin(), t.end());
+
+    c.time.push_back(percentile(t, 50));
+    c.cost.push_back(st.area2 + ref.b_cost_curve*st.curves + ref.b_cost_segment*st.segments);
+    c.size.push_back(st.curves + st.segments);
+    c.area.push_back(st.area2);
+}
+
+
+static bool dominates(const candidate* a, const candidate* b)
+{
+    return a->total_time <= b->total_time && a->total_cost <= b->total_cost &&
+           (a->total_time < b->total_time || a->total_cost < b->total_cost);
+}
+
+
+// sort by Pareto layer (non-dominated sorting), then by cost
+static void pareto_sort(vector<candidate*>& alive)
+{
+    vector<candidate*> rest = alive;
+
+    for (int layer=0; !rest.empty(); layer++)
+    {
+        vector<candidate*> next;
+        for (int i=0; i<(int)rest.size(); i++)
+        {
+            bool dominated = false;
+            for (int k=0; k<(int)rest.size() && !dominated; k++)
+                dominated = dominates(rest[k], rest[i]);
+            if (dominated)
+                next.push_back(rest[i]);
+            else
+                rest[i]->layer = layer;
+        }
+        rest.swap(next);
+    }
+
+    stable_sort(alive.begin(), alive.end(), [](const candidate* a, const candidate* b)
+        { return a->layer!=b->layer ? a->layer < b->layer : a->total_cost < b->total_cost; });
+}
+
+
+// results on the first images
+static void print_candidate(const char* type, const candidate& c, int images)
+{
+    double time = 0, cost = 0, area = 0;
+    int size = 0;
+    for (int i=0; i<images; i++)
+    {
+        time += c.time[i];
+        cost += c.cost[i];
+        area += c.area[i];
+        size += c.size[i];
+    }
+
+    printf("{\"type\":\"%s\",\"params\":\"%s\",\"ms\":%.3f,\"cost\":%.0f,\"area2\":%.0f,\"segments\":%d}\n",
+        type, c.label.c_str(), time, cost, area, size);
+}
+
+
+int main(int argc, char** argv)
+{
+    int sample = 16;
+    int count = 64;
+    int reps = 3;
+    double tolerance = 0.01;
+    int seed = 1;
+    const char* out = "spvec.par";
+    vector<const char*> files;
+    vector<axis> axes;
+    parameter par;
+
+    par.load("spvec.par");
+
+    for (int i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "--sample")==0 && i+1<argc)
+            sample = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--candidates")==0 && i+1<argc)
+            count = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--reps")==0 && i+1<argc)
+            reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tolerance")==0 && i+1<argc)
+            tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed")==0 && i+1<argc)
+            seed = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out")==0 && i+1<argc)
+            out = argv[++i];
+        else if (strstr(argv[i],".png")!=NULL || strstr(argv[i],".PNG")!=NULL)
+            files.push_back(argv[i]);
+        else if (strchr(argv[i], '=')!=NULL && strchr(argv[i], ',')!=NULL)
+        {
+            axes.resize(axes.size()+1);
+            if (!axes.back().parse(argv[i]))
+            {
+                fprintf(stderr, "can't parse: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!par.parse(argv[i]))
+            fprintf(stderr, "can't parse: %s\n", argv[i]);
+    }
+
+    if (files.empty())
+    {
+        fprintf(stderr, "usage: spvec_tune [--sample N] [--candidates N] [--reps N] [--tolerance F]\n"
+                        "                  [--seed N] [--out FILE] FILE.png ... [name=value,value,...] [name=value ...]\n");
+        return 1;
+    }
+
+    if (axes.empty())
+        for (int i=0; default_axes[i]!=NULL; i++)
+        {
+            axes.resize(axes.size()+1);
+            axes.back().parse(default_axes[i]);
+        }
+
+    if (reps < 1)
+        reps = 1;
+
+    mt19937 rng(seed);
+
+    // random sample of the images, decoded once
+    shuffle(files.begin(), files.end(), rng);
+    if (sample > 0 && sample < (int)files.size())
+        files.resize(sample);
+
+    vector<bitmap> maps(files.size());
+    for (int i=0; i<(int)files.size(); i++)
+    {
+        int ret = maps[i].init_from_png(files[i]);
+        if (ret!=0)
+        {
+            fprintf(stderr, "can't read %s (%d)\n", files[i], ret);
+            return 1;
+        }
+    }
+
+    // candidate 0 = current parameters, then random points of the grid
+    vector<candidate> all(1);
+    all[0].par = par;
+    all[0].label = "current";
+
+    double grid = 1;
+    for (int a=0; a<(int)axes.size(); a++)
+        grid *= axes[a].values.size();
+
+    set<string> labels;
+    for (int tries=0; (int)all.size() < count && tries < 20*count && labels.size() < grid; tries++)
+    {
+        candidate c;
+        c.par = par;
+        for (int a=0; a<(int)axes.size(); a++)
+        {
+            const axis& x = axes[a];
+            string s = x.name + "=" + x.values[rng() % x.values.size()];
+            c.par.parse(s.c_str());
+            c.label += (a ? " " : "") + s;
+        }
+        if (labels.insert(c.label).second)
+            all.push_back(c);
+    }
+
+    vector<candidate*> alive;
+    for (int i=0; i<(int)all.size(); i++)
+        alive.push_back(&all[i]);
+
+    // successive halving
+    int n = files.size();
+    int images = 1;
+    for (int round=0; ; round++)
+    {
+        if (images > n)
+            images = n;
+
+        double c0 = time_ms();
+        for (int k=0; k<(int)alive.size(); k++)
+        {
+            candidate& c = *alive[k];
+            for (int i=c.time.size(); i<images; i++)
+                evaluate(c, par, maps[i], reps);
+
+            c.total_time = c.total_cost = 0;
+            for (int i=0; i<images; i++)
+            {
+                c.total_time += c.time[i];
+                c.total_cost += c.cost[i];
+            }
+        }
+
+        pareto_sort(alive);
+
+        int keep = images < n ? max(4, ((int)alive.size()+1)/2) : alive.size();
+        printf("{\"round\":%d,\"images\":%d,\"candidates\":%d,\"kept\":%d,\"seconds\":%.3f}\n",
+            round, images, (int)alive.size(), min(keep, (int)alive.size()), (time_ms()-c0)/1000);
+        fflush(stdout);
+
+        if (images == n)
+            break;
+
+        if (keep < (int)alive.size())
+            alive.resize(keep);
+        images *= 2;
+    }
+
+    // Pareto front of the last round, by time
+    vector<candidate*> front;
+    for (int k=0; k<(int)alive.size(); k++)
+        if (alive[k]->layer == 0)
+            front.push_back(alive[k]);
+    sort(front.begin(), front.end(), [](const candidate* a, const candidate* b)
+        { return a->total_time < b->total_time; });
+
+    double best = front[0]->total_cost;
+    for (int k=0; k<(int)front.size(); k++)
+    {
+        best = min(best, front[k]->total_cost);
+        print_candidate("front", *front[k], n);
+    }
+
+    candidate* chosen = front.back();
+    for (int k=0; k<(int)front.size(); k++)
+        if (front[k]->total_cost <= best*(1+tolerance))
+        {
+            chosen = front[k];
+            break;
+        }
+
+    // the current parameters for comparison, also if eliminated
+    for (int i=all[0].time.size(); i<n; i++)
+        evaluate(all[0], par, maps[i], reps);
+    print_candidate("current", all[0], n);
+    print_candidate("chosen", *chosen, n);
+
+    if (!chosen->par.save(out))
+    {
+        fprintf(stderr, "can't write %s\n", out);
+        return 1;
+    }
+
+    return 0;
+}
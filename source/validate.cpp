@@ -0,0 +1,624 @@
+/*
+ * Validation of the single precision build (make FLOAT=1)
+ *
+ * spvec_validate --kernels [--count N] [--seed N]
+ * spvec_validate --save FILE FILE.png ... [name=value ...]
+ * spvec_validate --compare FILE FILE.png ... [name=value ...]
+ * spvec_validate --nesting FILE.png ... [name=value ...]
+ * spvec_validate --verify FILE.png ... [name=value ...]
+ *
+ * --kernels runs the geometry kernels bezier_points() and calc_area() in
+ * float and in double on the same random curves and polylines (N per row,
+ * default 100000), from curves of a few pixels up to 100000 pixels and at
+ * offsets from the origin up to 1000000. The coordinates are rounded to
+ * float first, so that only the arithmetic differs. One JSON line per
+ * extent and offset reports the largest distance of the curve points, the
+ * tests within b_max_distance in both precisions, the largest difference of
+ * their areas and the number of them that differ by more than 0.1%, and the
+ * calc_area() decisions (distance within b_max_distance) that differ. For
+ * comparison, jitter counts the areas and decisions of the double kernels
+ * alone that change if the curve points move by up to 1e-9 pixels.
+ *
+ * --save vectorizes the images and writes the flattened final path of every
+ * contour to FILE, --compare vectorizes them again (usually with the other
+ * build) and compares every contour with the saved one: the same number of
+ * lines and curves, the pixels filled by only one of them and their
+ * Hausdorff distance (see verify). One JSON line per image and a summary
+ * line are written to stdout.
+ *
+ * --nesting traces the images sequentially and in bands (tr_bands, default
+ * 4) and checks the nesting of every contour against a brute-force
+ * containment test: its parent must be the smallest contour enclosing it
+ * and its depth the number of contours enclosing it. Both tracers have to
+ * give the same contours. One JSON line per image with the mismatches, the
+ * exit code is 1 if there are any.
+ *
+ * --verify vectorizes the images with all contours (tr_min_area=0) and
+ * checks the image-wide comparison of verify: the image is the even-odd
+ * fill of the traced contours (the image frame inverted), so the pixels
+ * that differ can't be more than the sum of the errors of the contours.
+ * One JSON line per image, the exit code is 1 if an image fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+
+#include "spvec.h"
+#include "bitmap.h"
+#include "bezier.h"
+#include "area.h"
+#include "verify.h"
+#include "tracer.h"
+#include "timer.h"
+
+
+// deterministic random numbers (splitmix64)
+class generator
+{
+private:
+    uint64_t state;
+
+public:
+    generator(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // uniform in [a,b)
+    double uniform(double a, double b)
+    {
+        return a + (b-a) * (next() >> 11) * (1.0/9007199254740992.0);
+    }
+};
+
+
+// differences of the kernels for one extent and offset
+class kernel_diff
+{
+public:
+    double extent, offset;
+    int    tests;
+    double points;          // largest distance of the curve points (pixels)
+    int    feasible;        // calc_area() true in both precisions
+    double area;            // largest difference of the areas (square pixels)
+    int    areas;           // areas that differ by more than 0.1% (+0.001)
+    int    decisions;       // calc_area() results that differ
+    int    jitter;          // areas in double that differ by more than 0.1% if the
+                            // curve points move by up to 1e-9 pixels
+
+    kernel_diff() : extent(0), offset(0), tests(0), points(0), feasible(0), area(0), areas(0),
+        decisions(0), jitter(0) {}
+};
+
+
+/**
+ * Random curve b of about the length extent at offset, without loops, and
+ * a polyline p from b[0] to b[3] along it, as calc_area() expects: points
+ * of the curve at least 2 pixels apart, moved by up to 0.4 pixels and
+ * rounded to half pixels like the intermediate points of a traced path.
+ */
+static void random_curve(generator& rnd, double extent, double offset, vertex* b, vector<vertex>& p)
+{
+    double len = extent * rnd.uniform(0.5, 1);
+    double a = rnd.uniform(0, 2*M_PI);
+    double a1 = a + rnd.uniform(-1, 1);
+    double a2 = a + rnd.uniform(-1, 1);
+
+    b[0] = vertex(offset + rnd.uniform(0, 1), offset + rnd.uniform(0, 1));
+    b[3] = b[0] + len*vertex(cos(a), sin(a));
+    b[1] = b[0] + len/3*vertex(cos(a1), sin(a1));
+    b[2] = b[3] - len/3*vertex(cos(a2), sin(a2));
+
+    vertex c[64+1];
+    bezier_points(b, c, 64);
+
+    int n = 2 + (int)rnd.uniform(0, min(18.0, len/2));
+    p.clear();
+    p.push_back(b[0]);
+    for (int i=1; i<n; i++)
+    {
+        vertex q = c[i*64/n];
+        q.x = floor(2*(q.x + rnd.uniform(-0.4, 0.4)) + 0.5) / 2;
+        q.y = floor(2*(q.y + rnd.uniform(-0.4, 0.4)) + 0.5) / 2;
+        p.push_back(q);
+    }
+    p.push_back(b[3]);
+}
+
+
+// bezier_points() and calc_area() of one curve in both precisions
+static void compare_kernels(generator& rnd, double max_dist, kernel_diff& d)
+{
+    vertex b[4];
+    vector<vertex> p;
+    random_curve(rnd, d.extent, d.offset, b, p);
+
+    // the same input in both precisions
+    point_t<float> bf[4];
+    vector< point_t<float> > pf;
+    for (int k=0; k<4; k++)
+    {
+        bf[k] = point_t<float>(b[k]);
+        b[k] = vertex(bf[k]);
+    }
+    for (int i=0; i<(int)p.size(); i++)
+    {
+        pf.push_back(point_t<float>(p[i]));
+        p[i] = vertex(pf.back());
+    }
+
+    vertex c[16+1];
+    point_t<float> cf[16+1];
+    bezier_points(b, c, 16);
+    bezier_points(bf, cf, 16);
+    for (int i=0; i<=16; i++)
+        d.points = max(d.points, (vertex(cf[i]) - c[i]).len());
+
+    double a = 0, af = 0;
+    bool ok = calc_area(p.data(), p.size(), c, 17, max_dist, a);
+    bool okf = calc_area(pf.data(), pf.size(), cf, 17, max_dist, af);
+    if (ok != okf)
+        d.decisions++;
+    else if (ok)
+    {
+        d.feasible++;
+        d.area = max(d.area, fabs(af-a));
+        if (fabs(af-a) > 0.001*(a+1))
+            d.areas++;
+    }
+
+    // the same in double with the curve points moved a little
+    for (int i=1; i<16; i++)
+        c[i] = c[i] + vertex(rnd.uniform(-1e-9, 1e-9), rnd.uniform(-1e-9, 1e-9));
+    double aj = 0;
+    bool okj = calc_area(p.data(), p.size(), c, 17, max_dist, aj);
+    if (ok != okj || fabs(aj-a) > 0.001*(a+1))
+        d.jitter++;
+
+    d.tests++;
+}
+
+
+static int kernels(int count, uint64_t seed, double max_dist)
+{
+    static const double extents[] = { 4, 32, 256, 2048, 16384, 100000 };
+    static const double offsets[] = { 0, 1000, 100000, 1000000 };
+
+    for (int i=0; i<(int)(sizeof(extents)/sizeof(extents[0])); i++)
+        for (int j=0; j<(int)(sizeof(offsets)/sizeof(offsets[0])); j++)
+        {
+            generator rnd(seed + 1000*i + j);
+            kernel_diff d;
+            d.extent = extents[i];
+            d.offset = offsets[j];
+            for (int k=0; k<count; k++)
+                compare_kernels(rnd, max_dist, d);
+
+            printf("{\"extent\": %g, \"offset\": %g, \"tests\": %d, \"points\": %.3g, "
+                   "\"feasible\": %d, \"area\": %.3g, \"areas\": %d, \"decisions\": %d, \"jitter\": %d}\n",
+                d.extent, d.offset, d.tests, d.points, d.feasible, d.area, d.areas, d.decisions,
+                d.jitter);
+        }
+
+    return 0;
+}
+
+
+// number of lines and curves of p
+static void count_elements(const path& p, int& lines, int& curves)
+{
+    lines = curves = 0;
+    for (int i=1; i<(int)p.size(); i++)
+        if (p[i].flag & BEZIER)
+            curves++;
+        else
+            lines++;
+}
+
+
+static bool write_int(FILE* f, int32_t x)
+{
+    return fwrite(&x, sizeof(x), 1, f)==1;
+}
+
+
+static bool read_int(FILE* f, int32_t& x)
+{
+    return fread(&x, sizeof(x), 1, f)==1;
+}
+
+
+/**
+ * The reference file: for every image the number of contours, then for
+ * every contour the number of lines, of curves and of points of the
+ * flattened path and the points (double x, y). Native byte order, the
+ * file is only read on the same machine.
+ */
+static bool save_paths(FILE* f, const vector<path>& outline)
+{
+    bool ok = write_int(f, outline.size());
+
+    polygon q;
+    for (int i=0; i<(int)outline.size() && ok; i++)
+    {
+        int lines, curves;
+        count_elements(outline[i], lines, curves);
+        flatten(outline[i], q);
+
+        ok = write_int(f, lines) && write_int(f, curves) && write_int(f, q.size());
+        for (int k=0; k<(int)q.size() && ok; k++)
+        {
+            double xy[2] = { q[k].x, q[k].y };
+            ok = fwrite(xy, sizeof(xy), 1, f)==1;
+        }
+    }
+
+    return ok;
+}
+
+
+// differences of the results of one image
+class result_diff
+{
+public:
+    int    contours;        // contours compared
+    int    structure;       // contours with other numbers of lines or curves
+    int    changed;         // contours that differ by at least one pixel or 0.01 pixels
+    long long pixels;       // pixels filled by only one of the paths, summed
+    int    max_pixels;      // largest pixel difference of a contour
+    double hausdorff;       // largest Hausdorff distance of a contour
+    int    worst;           // id of the contour with the largest Hausdorff distance
+
+    result_diff() : contours(0), structure(0), changed(0), pixels(0), max_pixels(0),
+        hausdorff(0), worst(-1) {}
+};
+
+
+// compares the saved paths of an image with outline
+static bool compare_paths(FILE* f, const vector<path>& outline, result_diff& d)
+{
+    int32_t n;
+    if (!read_int(f, n) || n != (int)outline.size())
+        return false;
+
+    polygon p, q;
+    for (int i=0; i<n; i++)
+    {
+        int32_t lines, curves, size;
+        if (!read_int(f, lines) || !read_int(f, curves) || !read_int(f, size) || size < 0)
+            return false;
+
+        p.resize(size);
+        for (int k=0; k<size; k++)
+        {
+            double xy[2];
+            if (fread(xy, sizeof(xy), 1, f)!=1)
+                return false;
+            p[k] = vertex(xy[0], xy[1]);
+        }
+
+        int l, c;
+        count_elements(outline[i], l, c);
+        flatten(outline[i], q);
+        if (p.empty() != q.empty())
+        {
+            d.structure++;
+            d.changed++;
+            continue;
+        }
+        if (p.empty())
+            continue;
+
+        d.contours++;
+        if (l != lines || c != curves)
+            d.structure++;
+
+        contour_error e;
+        compare_polygons(p, q, e);
+        if (e.pixels > 0 || e.hausdorff >= 0.01)
+            d.changed++;
+        d.pixels += e.pixels;
+        d.max_pixels = max(d.max_pixels, e.pixels);
+        if (e.hausdorff > d.hausdorff)
+        {
+            d.hausdorff = e.hausdorff;
+            d.worst = i;
+        }
+    }
+
+    return true;
+}
+
+
+// traces all contours of map, in n bands if n > 0
+static void trace_all(const bitmap& map, int n, vector<path>& p, vector<contour>& c)
+{
+    tracer t(map);
+    if (n > 0)
+        t.trace_bands(n);
+
+    p.clear();
+    int x, y;
+    while (t.get_next_contour(x, y))
+    {
+        p.resize(p.size()+1);
+        t.trace_points(x, y, false, p.back());
+    }
+
+    c.clear();
+    for (int i=0; i<t.get_contour_count(); i++)
+        c.push_back(t.get_contour(i));
+}
+
+
+/**
+ * Checks the nesting of the contours against a brute-force containment
+ * test, returns the number of contours with another parent or depth. A
+ * point in the middle of a vertical edge of a contour lies inside another
+ * contour if a ray to the right crosses an odd number of its vertical
+ * edges, the edges of different contours never coincide.
+ */
+static int check_nesting(const bitmap& map, const vector<path>& p, const vector<contour>& c)
+{
+    int n = p.size();
+
+    // vertical edges (x, contour) of every row
+    vector< vector< pair<int,int> > > rows(map.get_height());
+    for (int i=0; i<n; i++)
+        for (int k=1; k<(int)p[i].size(); k++)
+            if (p[i][k].x == p[i][k-1].x)
+                rows[(int)min(p[i][k].y, p[i][k-1].y)].push_back(make_pair((int)p[i][k].x, i));
+
+    int mismatches = 0;
+    vector<int> crossings(n, 0);
+
+    for (int i=0; i<n; i++)
+    {
+        int k = 1;
+        while (p[i][k].x != p[i][k-1].x)
+            k++;
+        int x = p[i][k].x;
+        const vector< pair<int,int> >& row = rows[(int)min(p[i][k].y, p[i][k-1].y)];
+
+        for (int j=0; j<(int)row.size(); j++)
+            if (row[j].first > x && row[j].second != i)
+                crossings[row[j].second]++;
+
+        int parent = -1, depth = 0;
+        for (int j=0; j<(int)row.size(); j++)
+        {
+            int id = row[j].second;
+            if (crossings[id] & 1)
+            {
+                depth++;
+                if (parent < 0 || c[id].area < c[parent].area)
+                    parent = id;
+            }
+            crossings[id] = 0;      // counted once, reset for the next contour
+        }
+
+        if (parent != c[i].parent || depth != c[i].depth)
+        {
+            if (mismatches < 5)
+                fprintf(stderr, "contour %d: parent %d depth %d, expected %d %d\n",
+                    i, c[i].parent, c[i].depth, parent, depth);
+            mismatches++;
+        }
+    }
+
+    return mismatches;
+}
+
+
+// --nesting, see above
+static int nesting(const vector<const char*>& files, int bands)
+{
+    bool ok = true;
+
+    for (int i=0; i<(int)files.size(); i++)
+    {
+        bitmap map;
+        int ret = map.init_from_png(files[i]);
+        if (ret!=0)
+        {
+            fprintf(stderr, "can't read %s (%d)\n", files[i], ret);
+            return 1;
+        }
+
+        vector<path> p1, p2;
+        vector<contour> c1, c2;
+        trace_all(map, 0, p1, c1);
+        trace_all(map, bands, p2, c2);
+
+        // the same contours and nesting in bands
+        int differ = p1.size()!=p2.size() ? 1 : 0;
+        for (int k=0; k<(int)p1.size() && !differ; k++)
+            if (p1[k].size()!=p2[k].size() || !(p1[k][0]==p2[k][0]) ||
+                c1[k].parent!=c2[k].parent || c1[k].depth!=c2[k].depth || c1[k].hole!=c2[k].hole)
+                differ = 1;
+
+        int mismatches = check_nesting(map, p1, c1);
+
+        printf("{\"file\": \"%s\", \"contours\": %d, \"mismatches\": %d, \"bands_differ\": %s}\n",
+            files[i], (int)p1.size(), mismatches, differ ? "true" : "false");
+
+        if (mismatches || differ)
+            ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
+
+
+// --verify, see above
+static int check_verify(const vector<const char*>& files, parameter par)
+{
+    bool ok = true;
+
+    par.tr_min_area = 0;
+    par.verify = 1;
+
+    for (int i=0; i<(int)files.size(); i++)
+    {
+        bitmap map;
+        int ret = map.init_from_png(files[i]);
+        if (ret!=0)
+        {
+            fprintf(stderr, "can't read %s (%d)\n", files[i], ret);
+            return 1;
+        }
+
+        statistics st;
+        vector<path> outline;
+        vectorize(par, map, NULL, st, &outline, NULL);
+
+        // the errors of all contours
+        fidelity f;
+        verify(map, outline, outline.size(), f);
+        long long sum = 0;
+        for (int k=0; k<(int)f.worst.size(); k++)
+            sum += f.worst[k].pixels;
+
+        printf("{\"file\": \"%s\", \"contours\": %d, \"pixels\": %d, \"contour_pixels\": %lld}\n",
+            files[i], f.contours, f.pixels, sum);
+
+        if (f.pixels > sum)
+            ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
+
+
+int main(int argc, char** argv)
+{
+    bool kernel_mode = false;
+    bool nesting_mode = false;
+    bool verify_mode = false;
+    const char* save = NULL;
+    const char* reference = NULL;
+    int count = 100000;
+    long seed = 1;
+    vector<const char*> files;
+    parameter par;
+
+    par.load("spvec.par");
+
+    for (int i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "--kernels")==0)
+            kernel_mode = true;
+        else if (strcmp(argv[i], "--nesting")==0)
+            nesting_mode = true;
+        else if (strcmp(argv[i], "--verify")==0)
+            verify_mode = true;
+        else if (strcmp(argv[i], "--count")==0 && i+1<argc)
+            count = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed")==0 && i+1<argc)
+            seed = atol(argv[++i]);
+        else if (strcmp(argv[i], "--save")==0 && i+1<argc)
+            save = argv[++i];
+        else if (strcmp(argv[i], "--compare")==0 && i+1<argc)
+            reference = argv[++i];
+        else if (strstr(argv[i],".png")!=NULL || strstr(argv[i],".PNG")!=NULL)
+            files.push_back(argv[i]);
+        else if (!par.parse(argv[i]))
+            fprintf(stderr, "can't parse: %s\n", argv[i]);
+    }
+
+    if (kernel_mode)
+        return kernels(count, seed, par.b_max_distance);
+
+    if (nesting_mode && !files.empty())
+        return nesting(files, par.tr_bands > 0 ? par.tr_bands : 4);
+    if (verify_mode && !files.empty())
+        return check_verify(files, par);
+
+    if (files.empty() || (save==NULL) == (reference==NULL))
+    {
+        fprintf(stderr, "usage: spvec_validate --kernels [--count N] [--seed N]\n"
+                        "       spvec_validate --save FILE FILE.png ... [name=value ...]\n"
+                        "       spvec_validate --compare FILE FILE.png ... [name=value ...]\n"
+                        "       spvec_validate --nesting FILE.png ... [name=value ...]\n"
+                        "       spvec_validate --verify FILE.png ... [name=value ...]\n");
+        return 1;
+    }
+
+    FILE* f = fopen(save ? save : reference, save ? "wb" : "rb");
+    if (f==NULL)
+    {
+        fprintf(stderr, "can't open %s\n", save ? save : reference);
+        return 1;
+    }
+
+    const char* precision = sizeof(coord)==sizeof(float) ? "float" : "double";
+    result_diff total;
+    bool ok = true;
+
+    for (int i=0; i<(int)files.size() && ok; i++)
+    {
+        bitmap map;
+        int ret = map.init_from_png(files[i]);
+        if (ret!=0)
+        {
+            fprintf(stderr, "can't read %s (%d)\n", files[i], ret);
+            ok = false;
+            break;
+        }
+
+        statistics st;
+        vector<path> outline;
+        double c0 = time_ms();
+        vectorize(par, map, NULL, st, &outline, NULL);
+        double time = time_ms() - c0;
+
+        if (save)
+        {
+            ok = save_paths(f, outline);
+            printf("{\"file\": \"%s\", \"precision\": \"%s\", \"contours\": %d, "
+                   "\"curves\": %d, \"segments\": %d, \"area2\": %.3f, \"time_ms\": %.1f}\n",
+                files[i], precision, st.contours, st.curves, st.segments, st.area2, time);
+            continue;
+        }
+
+        result_diff d;
+        ok = compare_paths(f, outline, d);
+        if (!ok)
+        {
+            fprintf(stderr, "%s: the reference doesn't match\n", files[i]);
+            break;
+        }
+
+        printf("{\"file\": \"%s\", \"precision\": \"%s\", \"contours\": %d, \"structure\": %d, "
+               "\"changed\": %d, \"pixels\": %lld, \"max_pixels\": %d, \"hausdorff\": %.3f, "
+               "\"worst\": %d, \"area2\": %.3f, \"time_ms\": %.1f}\n",
+            files[i], precision, d.contours, d.structure, d.changed, d.pixels, d.max_pixels,
+            d.hausdorff, d.worst, st.area2, time);
+
+        total.contours += d.contours;
+        total.structure += d.structure;
+        total.changed += d.changed;
+        total.pixels += d.pixels;
+        total.max_pixels = max(total.max_pixels, d.max_pixels);
+        total.hausdorff = max(total.hausdorff, d.hausdorff);
+    }
+
+    if (ok && reference)
+        printf("{\"summary\": true, \"contours\": %d, \"structure\": %d, \"changed\": %d, "
+               "\"pixels\": %lld, \"max_pixels\": %d, \"hausdorff\": %.3f}\n",
+            total.contours, total.structure, total.changed, total.pixels,
+            total.max_pixels, total.hausdorff);
+
+    fclose(f);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,565 @@
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+
+#include "verify.h"
+#include "tracer.h"
+#include "bezier.h"
+#include "timer.h"
+#include "timeline.h"
+
+
+#define STEP 0.5            // length of the pieces of flattened curves and of the samples
+#define CELL 2.0            // cell size of segment_grid
+
+
+// number of set bits
+static inline int popcount(uint64_t x)
+{
+#ifdef __GNUC__
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x>>1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x>>2) & 0x3333333333333333ULL);
+    x = (x + (x>>4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+
+/**
+ * Flattens the closed path p into the polygon q (q.back() == q[0]). Bézier
+ * curves are cut into 2^k pieces whose control polygons are at most about
+ * STEP long, lines stay as they are.
+ */
+void flatten(const path& p, polygon& q)
+{
+    q.clear();
+    if (p.empty())
+        return;
+
+    q.push_back(vertex(p[0]));
+    for (int i=1; i<(int)p.size(); i++)
+    {
+        if (p[i].flag & BEZIER)
+        {
+            point b[4] = { p[i-1], p[i].xy[0], p[i].xy[1], p[i] };
+            double len = (b[1]-b[0]).len() + (b[2]-b[1]).len() + (b[3]-b[2]).len();
+            int cnt = 1;
+            while (cnt < 64 && len > cnt*STEP)
+                cnt *= 2;
+
+            point c[64+1];
+            bezier_points(b, c, cnt);
+            for (int k=1; k<=cnt; k++)
+                q.push_back(vertex(c[k]));
+        }
+        else
+            q.push_back(vertex(p[i]));
+    }
+
+    if (!(q.back() == q[0]))
+        q.push_back(q[0]);
+}
+
+
+/**
+ * Even-odd scanline fill of polygons into a window of w x h pixels at
+ * (x0,y0), a pixel is set if its center is inside. Every row is a bit
+ * vector of 64 bit words with the first pixel in the most significant bit,
+ * the order of the bytes of a bitmap row. An edge only toggles the first
+ * pixel right of its crossing with the center line of a row, fill() turns
+ * the toggles into spans with a prefix XOR over every word.
+ */
+class scanline_fill
+{
+private:
+    int x0, y0, w, h;
+    int words;              // per row
+    vector<uint64_t> bits;
+
+public:
+    void init(int x0, int y0, int w, int h);
+    void add_polygon(const polygon& q);
+    void fill();
+
+    int  get_words() const { return words; }
+    const uint64_t* row(int y) const { return &bits[(size_t)y*words]; }
+
+private:
+    void add_edge(vertex a, vertex b);
+};
+
+
+void scanline_fill::init(int x0, int y0, int w, int h)
+{
+    this->x0 = x0;
+    this->y0 = y0;
+    this->w = w;
+    this->h = h;
+    words = (w+63) >> 6;
+    bits.assign((size_t)words*h, 0);
+}
+
+
+void scanline_fill::add_edge(vertex a, vertex b)
+{
+    if (a.y == b.y)
+        return;
+    if (a.y > b.y)
+        swap(a, b);
+
+    // rows whose center line y+0.5 is in [a.y, b.y)
+    int ya = max((int)ceil(a.y-0.5), y0);
+    int yb = min((int)ceil(b.y-0.5), y0+h);
+    double dxdy = (b.x-a.x) / (b.y-a.y);
+
+    for (int y=ya; y<yb; y++)
+    {
+        double x = a.x + (y+0.5-a.y)*dxdy;
+        int c = (int)floor(x+0.5) - x0;     // first pixel whose center is right of x
+        if (c >= w)
+            continue;
+        if (c < 0)
+            c = 0;
+
+        bits[(size_t)(y-y0)*words + (c>>6)] ^= (uint64_t)1 << (63-(c&63));
+    }
+}
+
+
+// adds the edges of the closed polygon q
+void scanline_fill::add_polygon(const polygon& q)
+{
+    for (int i=1; i<(int)q.size(); i++)
+        add_edge(q[i-1], q[i]);
+}
+
+
+void scanline_fill::fill()
+{
+    uint64_t tail = (w&63) ? ~(uint64_t)0 << (64-(w&63)) : ~(uint64_t)0;
+
+    for (int y=0; y<h; y++)
+    {
+        uint64_t* r = &bits[(size_t)y*words];
+        uint64_t carry = 0;     // all ones inside
+
+        for (int k=0; k<words; k++)
+        {
+            uint64_t x = r[k];
+            x ^= x >> 1;
+            x ^= x >> 2;
+            x ^= x >> 4;
+            x ^= x >> 8;
+            x ^= x >> 16;
+            x ^= x >> 32;
+            x ^= carry;
+            carry = 0 - (x & 1);
+            r[k] = x;
+        }
+
+        // a span may reach past the window
+        if (words > 0)
+            r[words-1] &= tail;
+    }
+}
+
+
+/**
+ * Distance of points to a polygon. The edges are cut into pieces of at
+ * most one cell, in the order of the polygon, and every cell lists the
+ * pieces with their middle in it (piece[first[c]]..piece[first[c+1]-1]).
+ * distance2() searches rings of cells around the point until no piece
+ * outside can be closer.
+ */
+class segment_grid
+{
+private:
+    // piece a + t*d, 0 <= t <= 1, inv = 1/|d|^2
+    class piece_t
+    {
+    public:
+        vertex a, d;
+        double inv;
+    };
+
+    double x0, y0;
+    int nx, ny;
+    vector<piece_t> pieces;
+    vector<int> cell;       // cell of every piece
+    vector<int> first;
+    vector<int> piece;
+    vector<int> next;
+
+    int cell_x(double x) const { return max(0, min(nx-1, (int)((x-x0)/CELL))); }
+    int cell_y(double y) const { return max(0, min(ny-1, (int)((y-y0)/CELL))); }
+
+    // squared distance of p to piece i
+    double piece_distance2(vertex p, int i) const
+    {
+        const piece_t& s = pieces[i];
+        vertex e = p - s.a;
+        double t = (e.x*s.d.x + e.y*s.d.y) * s.inv;
+        t = max(0.0, min(1.0, t));
+        return (e - s.d*t).len2();
+    }
+
+public:
+    void init(const polygon& q, double x0, double y0, double x1, double y1);
+    double distance2(vertex p, double limit2, int& hint) const;
+};
+
+
+/**
+ * @param q       closed polygon
+ * @param x0..y1  bounding box of q and of the points passed to distance2()
+ */
+void segment_grid::init(const polygon& q, double x0, double y0, double x1, double y1)
+{
+    this->x0 = x0;
+    this->y0 = y0;
+    nx = (int)((x1-x0)/CELL) + 1;
+    ny = (int)((y1-y0)/CELL) + 1;
+
+    pieces.clear();
+    cell.clear();
+    for (int i=1; i<(int)q.size(); i++)
+    {
+        vertex d = q[i] - q[i-1];
+        double len2 = d.len2();
+        int n = len2 <= CELL*CELL ? 1 : (int)ceil(sqrt(len2)/CELL);
+
+        piece_t s;
+        s.d = d * (1.0/n);
+        s.inv = len2 > 0 ? n*n/len2 : 0;
+        for (int k=0; k<n; k++)
+        {
+            s.a = q[i-1] + d*((double)k/n);
+            pieces.push_back(s);
+            cell.push_back(cell_y(s.a.y + s.d.y/2)*nx + cell_x(s.a.x + s.d.x/2));
+        }
+    }
+
+    // counting sort by cell
+    first.assign(nx*ny+1, 0);
+    for (int i=0; i<(int)cell.size(); i++)
+        first[cell[i]+1]++;
+    for (int c=0; c<nx*ny; c++)
+        first[c+1] += first[c];
+
+    piece.resize(cell.size());
+    next.assign(first.begin(), first.end()-1);
+    for (int i=0; i<(int)cell.size(); i++)
+        piece[next[cell[i]]++] = i;
+}
+
+
+/**
+ * Squared distance of p to the polygon. The search stops at the first
+ * piece closer than limit, then any distance up to limit is returned: the
+ * Hausdorff distance only needs the points farther than the largest
+ * distance so far. The pieces next to hint are tried first, consecutive
+ * points along a path are mostly close to them (in/out, -1 = none).
+ */
+double segment_grid::distance2(vertex p, double limit2, int& hint) const
+{
+    int n = pieces.size();
+
+    if (hint >= 0)
+        for (int k=-1; k<=2; k++)
+        {
+            int i = hint + k;
+            if (i < 0)
+                i += n;
+            else if (i >= n)
+                i -= n;
+
+            double d = piece_distance2(p, i);
+            if (d <= limit2)
+            {
+                hint = i;
+                return d;
+            }
+        }
+
+    int cx = cell_x(p.x);
+    int cy = cell_y(p.y);
+    double best = HUGE_VAL;
+
+    for (int r=0; r<=max(nx, ny); r++)
+    {
+        for (int y=cy-r; y<=cy+r; y++)
+        {
+            if (y < 0 || y >= ny)
+                continue;
+
+            // the whole first and last row of the ring, else its two ends
+            int step = (r==0 || y==cy-r || y==cy+r) ? 1 : 2*r;
+            for (int x=cx-r; x<=cx+r; x+=step)
+            {
+                if (x < 0 || x >= nx)
+                    continue;
+
+                int c = y*nx + x;
+                for (int j=first[c]; j<first[c+1]; j++)
+                {
+                    double d = piece_distance2(p, piece[j]);
+                    if (d < best)
+                    {
+                        best = d;
+                        hint = piece[j];
+                        if (best <= limit2)
+                            return best;
+                    }
+                }
+            }
+        }
+
+        // the middles of the remaining pieces are at least r cells away
+        double bound = r*CELL - CELL/2;
+        if (bound > 0 && best <= bound*bound)
+            break;
+    }
+
+    return best;
+}
+
+
+// 64 pixels of a bitmap row from byte 8*k on as in scanline_fill
+static inline uint64_t load(const unsigned char* row, int k, int bytes)
+{
+    const unsigned char* p = row + 8*k;
+    uint64_t x = 0;
+
+    if (bytes - 8*k >= 8)
+        for (int i=0; i<8; i++)
+            x = x<<8 | p[i];
+    else
+        for (int i=0; i<8; i++)
+            x = x<<8 | (8*k+i < bytes ? p[i] : 0);
+
+    return x;
+}
+
+
+// pixels that differ between map and the filled polygons f (of the same size),
+// the rows inside the image frame (see tracer) are compared inverted
+static int compare(const bitmap& map, const tracer& t, const scanline_fill& f)
+{
+    int w = map.get_width();
+    int h = map.get_height();
+    int bytes = (w+7) >> 3;
+    int words = f.get_words();
+    uint64_t tail = (w&63) ? ~(uint64_t)0 << (64-(w&63)) : ~(uint64_t)0;
+    int n = 0;
+
+    for (int y=0; y<h; y++)
+    {
+        const unsigned char* m = map.get_row_pointer(y);
+        const uint64_t* r = f.row(y);
+        uint64_t inv = t.in_frame(y) ? ~(uint64_t)0 : 0;
+
+        for (int k=0; k<words-1; k++)
+            n += popcount(load(m, k, bytes) ^ inv ^ r[k]);
+        if (words > 0)
+            n += popcount(((load(m, words-1, bytes) ^ inv) & tail) ^ r[words-1]);
+    }
+
+    return n;
+}
+
+
+/**
+ * Rasterizes closed paths (lines and Bézier curves) with the even-odd rule:
+ * a pixel of map is set if its center is inside.
+ *
+ * @return false if map can't be allocated
+ */
+bool rasterize(const vector<path>& paths, int width, int height, bitmap& map)
+{
+    if (!map.init(width, height))
+        return false;
+
+    scanline_fill f;
+    f.init(0, 0, width, height);
+
+    polygon q;
+    for (int i=0; i<(int)paths.size(); i++)
+    {
+        flatten(paths[i], q);
+        f.add_polygon(q);
+    }
+    f.fill();
+
+    int bytes = (width+7) >> 3;
+    for (int y=0; y<height; y++)
+    {
+        unsigned char* m = map.get_row_pointer(y);
+        const uint64_t* r = f.row(y);
+        for (int i=0; i<bytes; i++)
+            m[i] = (unsigned char)(r[i>>3] >> (56 - 8*(i&7)));
+    }
+
+    return true;
+}
+
+
+// buffers of compare_contour()
+class contour_check
+{
+public:
+    polygon traced, fitted;
+    scanline_fill f1, f2;
+    segment_grid grid;
+};
+
+
+/**
+ * Largest squared distance of the points of q to the polygon in grid, q is
+ * sampled every STEP pixels (the points and the middles of the edges of a
+ * traced contour). d is the largest distance so far.
+ */
+static double max_distance2(const segment_grid& grid, const polygon& q, double d)
+{
+    int hint = -1;
+    for (int i=1; i<(int)q.size(); i++)
+    {
+        vertex v = q[i] - q[i-1];
+        int n = max(1, (int)ceil(v.len()/STEP));
+        for (int k=0; k<n; k++)
+            d = max(d, grid.distance2(q[i-1] + v*((double)k/n), d, hint));
+    }
+
+    return d;
+}
+
+
+/**
+ * Compares two closed polygons, e.g. a traced contour with its fitted path:
+ * the pixels filled by only one of them within their bounding box and the
+ * Hausdorff distance.
+ */
+static void compare_contour(contour_check& c, contour_error& e)
+{
+    const polygon& p = c.traced;
+    const polygon& q = c.fitted;
+
+    double x0 = p[0].x, y0 = p[0].y, x1 = x0, y1 = y0;
+    for (int i=0; i<(int)p.size(); i++)
+    {
+        x0 = min(x0, p[i].x);  x1 = max(x1, p[i].x);
+        y0 = min(y0, p[i].y);  y1 = max(y1, p[i].y);
+    }
+    for (int i=0; i<(int)q.size(); i++)
+    {
+        x0 = min(x0, q[i].x);  x1 = max(x1, q[i].x);
+        y0 = min(y0, q[i].y);  y1 = max(y1, q[i].y);
+    }
+
+    int bx = (int)floor(x0);
+    int by = (int)floor(y0);
+    int bw = (int)ceil(x1) - bx + 1;
+    int bh = (int)ceil(y1) - by + 1;
+
+    c.f1.init(bx, by, bw, bh);
+    c.f1.add_polygon(p);
+    c.f1.fill();
+    c.f2.init(bx, by, bw, bh);
+    c.f2.add_polygon(q);
+    c.f2.fill();
+
+    e.pixels = 0;
+    for (int y=0; y<bh; y++)
+    {
+        const uint64_t* r1 = c.f1.row(y);
+        const uint64_t* r2 = c.f2.row(y);
+        for (int k=0; k<c.f1.get_words(); k++)
+            e.pixels += popcount(r1[k] ^ r2[k]);
+    }
+
+    // squared distances both ways
+    c.grid.init(p, x0, y0, x1, y1);
+    double d = max_distance2(c.grid, q, 0);
+    c.grid.init(q, x0, y0, x1, y1);
+    d = max_distance2(c.grid, p, d);
+
+    e.hausdorff = sqrt(d);
+}
+
+
+// compare_contour() of two polygons, e.id is not set
+void compare_polygons(const polygon& p, const polygon& q, contour_error& e)
+{
+    contour_check c;
+    c.traced = p;
+    c.fitted = q;
+    compare_contour(c, e);
+}
+
+
+/**
+ * Checks a result against its bitmap (parameter verify): the filled paths
+ * are compared with the image pixel by pixel, and every fitted contour
+ * with its traced contour (traced again here). Contours without path
+ * (dropped specks) only count in the total.
+ *
+ * @param map      the vectorized bitmap
+ * @param outline  final path of every contour (see vectorize())
+ * @param top      number of contours with the largest error kept in f.worst
+ * @param f        result
+ */
+void verify(const bitmap& map, const vector<path>& outline, int top, fidelity& f)
+{
+    double c0 = time_ms();
+    int w = map.get_width();
+    int h = map.get_height();
+
+    f = fidelity();
+
+    contour_check c;
+    tracer t(map);
+    path p;
+    vector<contour_error> errors;
+    int x, y;
+    while (t.get_next_contour(x, y))
+    {
+        int id = t.trace_points(x, y, false, p);
+        if (id >= (int)outline.size() || outline[id].empty())
+            continue;
+
+        c.traced.clear();
+        for (int i=0; i<(int)p.size(); i++)
+            c.traced.push_back(vertex(p[i]));
+        flatten(outline[id], c.fitted);
+
+        contour_error e;
+        e.id = id;
+        compare_contour(c, e);
+        errors.push_back(e);
+        f.hausdorff = max(f.hausdorff, e.hausdorff);
+    }
+    f.contours = errors.size();
+
+    // the whole image, after the tracer has found the image frame
+    scanline_fill all;
+    all.init(0, 0, w, h);
+    for (int i=0; i<(int)outline.size(); i++)
+    {
+        flatten(outline[i], c.fitted);
+        all.add_polygon(c.fitted);
+    }
+    all.fill();
+    f.pixels = compare(map, t, all);
+
+    if (top > (int)errors.size())
+        top = errors.size();
+    partial_sort(errors.begin(), errors.begin()+top, errors.end(),
+        [](const contour_error& a, const contour_error& b)
+        { return a.pixels > b.pixels || (a.pixels == b.pixels && a.hausdorff > b.hausdorff); });
+    f.worst.assign(errors.begin(), errors.begin()+top);
+
+    double c1 = time_ms();
+    f.time = c1 - c0;
+    timeline::record("verify", c0, c1, "contours", f.contours);
+}
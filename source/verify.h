@@ -0,0 +1,44 @@
+#ifndef _VERIFY_H_
+#define _VERIFY_H_
+
+#include <vector>
+using namespace std;
+
+#include "bitmap.h"
+#include "path.h"
+
+
+// the checks are calculated in double also with float coordinates
+typedef vector<vertex> polygon;
+
+
+// deviation of a fitted contour from its traced contour
+class contour_error
+{
+public:
+    int    id;              // contour id (see tracer)
+    int    pixels;          // pixels filled by only one of them
+    double hausdorff;       // Hausdorff distance (pixels)
+};
+
+
+// result of verify() (parameter verify)
+class fidelity
+{
+public:
+    int    pixels;          // pixels that differ between the image and the filled result
+    int    contours;        // contours compared
+    double hausdorff;       // largest Hausdorff distance of a contour
+    double time;            // ms
+    vector<contour_error> worst;    // contours with the largest pixel error
+
+    fidelity() : pixels(0), contours(0), hausdorff(0), time(0) {}
+};
+
+
+void flatten(const path& p, polygon& q);
+void compare_polygons(const polygon& p, const polygon& q, contour_error& e);
+bool rasterize(const vector<path>& paths, int width, int height, bitmap& map);
+void verify(const bitmap& map, const vector<path>& outline, int top, fidelity& f);
+
+#endif